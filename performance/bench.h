@@ -0,0 +1,399 @@
+#pragma once
+// 简单的可复用基准测试框架
+// 每个用例：预热 -> 自动标定迭代次数（使单轮耗时接近目标时长）-> 重复多轮，
+// 报告中位数、MAD（中位数绝对偏差）、最小值以及中位数的 95% 置信区间。
+// 计时源可选 steady_clock 或 rdtsc/rdtscp（TSC 频率启动时对照 steady_clock 标定）。
+// 开启 --perf 时，在正式测量的各轮期间读取硬件性能计数器，并报告每次操作的平均计数。
+//
+// 用法：
+//   auto r = bench::run("加法操作", [&](uint64_t n) {
+//       for (uint64_t i = 0; i < n; ++i) { ... }
+//   });
+//   bench::printRow(r);
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "perf_counter.h"
+#include "../template/serialize.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+// 定义防止内联的宏
+#if defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+// 防止优化掉计算结果
+// 编译器屏障，告诉编译器“这里的 value 被使用了”，从而防止那些看起来没有副作用的计算被优化掉
+// 并不会真正把数据写入内存，也不会显著影响测量延迟，而是确保你测量的那段代码不会被编译器剔除或重排序。
+template <typename T>
+inline void doNotOptimizeAway(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+namespace bench {
+
+struct Options {
+    double targetMs = 20.0;          // 每轮目标时长（毫秒），用于标定迭代次数
+    int repetitions = 11;            // 正式测量的轮数
+    int warmupRuns = 1;              // 标定完成后额外的预热轮数
+    uint64_t minIterations = 1;
+    uint64_t maxIterations = 1ULL << 36;
+    uint64_t fixedIterations = 0;    // 非 0 时跳过标定，直接使用该迭代次数
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;         // 每轮迭代次数
+    std::vector<double> samples;     // 每轮的 ns/次
+    double median = 0;
+    double mad = 0;
+    double min = 0;
+    double mean = 0;
+    double ciLow = 0;                // 中位数 95% 置信区间（基于次序统计量）
+    double ciHigh = 0;
+    perf::Counts counters;           // 每次操作的平均硬件计数（开启 --perf 时有效）
+};
+
+// 全局设置：计时源与绑核，由 parseArgs 从命令行读取
+struct Config {
+    bool useTsc = false;
+    bool perfCounters = false;
+    int pinCpu = -1;
+    double tscGhz = 0;               // 标定出的 TSC 频率（GHz），useTsc 时有效
+    std::string jsonPath;            // 非空时在退出时把所有表格写成 JSON
+    Options defaults;
+};
+
+inline Config& config() {
+    static Config c;
+    return c;
+}
+
+// 将当前线程绑定到指定 CPU，失败返回 false
+inline bool pinToCpu(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if BENCH_HAS_TSC
+// 计时区间开始：lfence 保证之前的指令已执行完再读 TSC
+inline uint64_t tscBegin() {
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+// 计时区间结束：rdtscp 等待之前的指令完成，lfence 阻止之后的指令提前执行
+inline uint64_t tscEnd() {
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+#endif
+
+// 对照 steady_clock 标定 TSC 频率，取多次测量的中位数
+inline double calibrateTscGhz() {
+#if BENCH_HAS_TSC
+    std::vector<double> ghz;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t t0 = nowNs();
+        uint64_t c0 = tscBegin();
+        while (nowNs() - t0 < 20 * 1000 * 1000) {
+        }
+        uint64_t c1 = tscEnd();
+        uint64_t t1 = nowNs();
+        ghz.push_back((double)(c1 - c0) / (double)(t1 - t0));
+    }
+    std::sort(ghz.begin(), ghz.end());
+    return ghz[ghz.size() / 2];
+#else
+    return 0;
+#endif
+}
+
+// printHeader / printRow 打印过的表格，--json= 时记录
+struct Table {
+    std::string title;
+    std::vector<Result> rows;
+};
+
+inline std::vector<Table>& tables() {
+    static std::vector<Table> t;
+    return t;
+}
+
+template <typename Writer>
+inline void writeResult(Writer& w, const Result& r) {
+    auto field = [&](const char* key, const auto& value) {
+        w.key(key);
+        w.value(value);
+        w.separator();
+    };
+    w.begin_object(11);
+    field("name", r.name);
+    field("iterations", r.iterations);
+    field("median_ns", r.median);
+    field("mad_ns", r.mad);
+    field("min_ns", r.min);
+    field("mean_ns", r.mean);
+    field("ci_low_ns", r.ciLow);
+    field("ci_high_ns", r.ciHigh);
+    field("samples_ns", r.samples);
+    field("tsc", config().useTsc);
+    // 只输出有效的计数器，没有开启 --perf 时为空对象
+    size_t valid = 0;
+    for (bool v : r.counters.valid) valid += v;
+    w.key("counters");
+    w.begin_object(valid);
+    bool once = false;
+    for (int i = 0; i < perf::kNumEvents; ++i) {
+        if (!r.counters.valid[i]) continue;
+        if (once) w.separator();
+        once = true;
+        w.key(perf::eventName(i));
+        w.value(r.counters.value[i]);
+    }
+    w.end_object();
+    w.end_object();
+}
+
+// 以流式方式写出 [{"title": ..., "rows": [...]}, ...]，不构造中间字符串
+inline void writeJson() {
+    const std::string& path = config().jsonPath;
+    std::FILE* fp = std::fopen(path.c_str(), "w");
+    if (!fp) {
+        std::cerr << "无法写入 " << path << std::endl;
+        return;
+    }
+    {
+        print_buffer out(fp);
+        json_writer<print_buffer> w(out);
+        const std::vector<Table>& ts = tables();
+        w.begin_array(ts.size());
+        for (size_t i = 0; i < ts.size(); ++i) {
+            if (i) w.separator();
+            w.begin_object(2);
+            w.key("title");
+            w.value(ts[i].title);
+            w.separator();
+            w.key("rows");
+            w.begin_array(ts[i].rows.size());
+            for (size_t j = 0; j < ts[i].rows.size(); ++j) {
+                if (j) w.separator();
+                writeResult(w, ts[i].rows[j]);
+            }
+            w.end_array();
+            w.end_object();
+        }
+        w.end_array();
+        out.put('\n');
+    }
+    std::fclose(fp);
+}
+
+// 支持的参数：--tsc 使用 rdtsc 计时；--perf 读取硬件性能计数器；--cpu=N 绑核；--reps=N 重复轮数；--target_ms=X 单轮目标时长；
+// --json=PATH 退出时把所有表格导出为 JSON
+inline void parseArgs(int argc, char* argv[]) {
+    Config& c = config();
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (std::strcmp(a, "--tsc") == 0) {
+            c.useTsc = BENCH_HAS_TSC;
+        } else if (std::strcmp(a, "--perf") == 0) {
+            c.perfCounters = true;
+        } else if (std::strncmp(a, "--cpu=", 6) == 0) {
+            c.pinCpu = std::atoi(a + 6);
+        } else if (std::strncmp(a, "--reps=", 7) == 0) {
+            c.defaults.repetitions = std::max(1, std::atoi(a + 7));
+        } else if (std::strncmp(a, "--target_ms=", 12) == 0) {
+            c.defaults.targetMs = std::atof(a + 12);
+        } else if (std::strncmp(a, "--json=", 7) == 0) {
+            c.jsonPath = a + 7;
+        }
+    }
+    if (c.pinCpu >= 0 && !pinToCpu(c.pinCpu)) {
+        std::cerr << "绑定 CPU " << c.pinCpu << " 失败" << std::endl;
+    }
+    if (c.perfCounters && !perf::threadCounters().ok()) {
+        std::cerr << "perf_event_open 不可用（检查 /proc/sys/kernel/perf_event_paranoid）" << std::endl;
+        c.perfCounters = false;
+    }
+    if (!c.jsonPath.empty()) {
+        tables();  // 先构造，保证析构晚于 atexit 回调
+        std::atexit(writeJson);
+    }
+    if (c.useTsc) {
+        c.tscGhz = calibrateTscGhz();
+        std::cout << "TSC 频率: " << std::fixed << std::setprecision(3)
+                  << c.tscGhz << " GHz" << std::endl;
+    }
+}
+
+// 执行一轮 fn(iterations)，返回耗时（纳秒）
+template <typename Fn>
+inline double timeOnce(Fn& fn, uint64_t iterations) {
+    const Config& c = config();
+#if BENCH_HAS_TSC
+    if (c.useTsc) {
+        uint64_t start = tscBegin();
+        fn(iterations);
+        uint64_t end = tscEnd();
+        return (double)(end - start) / c.tscGhz;
+    }
+#endif
+    auto start = std::chrono::steady_clock::now();
+    fn(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// 逐步放大迭代次数直到单轮耗时达到目标的一部分，再按比例外推；标定过程本身兼作预热
+template <typename Fn>
+inline uint64_t calibrate(Fn& fn, const Options& opt) {
+    const double targetNs = opt.targetMs * 1e6;
+    uint64_t n = opt.minIterations;
+    while (true) {
+        double ns = timeOnce(fn, n);
+        if (ns >= targetNs / 10 || n >= opt.maxIterations) {
+            double scaled = ns > 0 ? n * targetNs / ns : (double)opt.maxIterations;
+            return std::clamp<uint64_t>((uint64_t)scaled, opt.minIterations, opt.maxIterations);
+        }
+        n = std::min(n * 10, opt.maxIterations);
+    }
+}
+
+inline double medianOf(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    if (n == 0) return 0;
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// 根据样本计算统计量
+inline void summarize(Result& r) {
+    std::vector<double> s = r.samples;
+    std::sort(s.begin(), s.end());
+    size_t n = s.size();
+    r.median = medianOf(s);
+    r.min = s.front();
+    double sum = 0;
+    for (double x : s) sum += x;
+    r.mean = sum / n;
+    std::vector<double> dev;
+    for (double x : s) dev.push_back(std::fabs(x - r.median));
+    r.mad = medianOf(dev);
+    // 中位数的非参数置信区间：秩为 n/2 ± 1.96*sqrt(n)/2 的次序统计量
+    double half = 1.96 * std::sqrt((double)n) / 2;
+    long lo = (long)std::floor(n / 2.0 - half);
+    long hi = (long)std::ceil(n / 2.0 + half);
+    r.ciLow = s[std::clamp<long>(lo, 0, n - 1)];
+    r.ciHigh = s[std::clamp<long>(hi, 0, n - 1)];
+}
+
+// fn 的签名为 void(uint64_t iterations)，在内部执行 iterations 次被测操作
+template <typename Fn>
+Result run(const std::string& name, Fn&& fn, const Options& opt = config().defaults) {
+    Result r;
+    r.name = name;
+    r.iterations = opt.fixedIterations ? opt.fixedIterations : calibrate(fn, opt);
+    for (int i = 0; i < opt.warmupRuns; ++i) {
+        timeOnce(fn, r.iterations);
+    }
+    // 计数器在所有正式轮次期间累计，计时本身的开销被摊薄到可以忽略
+    perf::CounterGroup* counters = config().perfCounters ? &perf::threadCounters() : nullptr;
+    if (counters) counters->start();
+    for (int i = 0; i < opt.repetitions; ++i) {
+        r.samples.push_back(timeOnce(fn, r.iterations) / r.iterations);
+    }
+    if (counters) {
+        perf::Counts total = counters->stop();
+        double ops = (double)r.iterations * opt.repetitions;
+        for (int i = 0; i < perf::kNumEvents; ++i) {
+            r.counters.value[i] = total.value[i] / ops;
+            r.counters.valid[i] = total.valid[i];
+        }
+    }
+    summarize(r);
+    return r;
+}
+
+// fn 的每次迭代包含 opsPerIteration 次操作时，把结果换算成每次操作：
+// 样本、各统计量和硬件计数都除以 opsPerIteration（iterations 仍是每轮迭代次数）
+inline void scale(Result& r, double opsPerIteration) {
+    for (double& x : r.samples) x /= opsPerIteration;
+    r.median /= opsPerIteration;
+    r.mad /= opsPerIteration;
+    r.min /= opsPerIteration;
+    r.mean /= opsPerIteration;
+    r.ciLow /= opsPerIteration;
+    r.ciHigh /= opsPerIteration;
+    for (double& v : r.counters.value) v /= opsPerIteration;
+}
+
+// 名称放在最后一列，避免中文宽度导致表格错位
+inline void printHeader(const std::string& title) {
+    if (!config().jsonPath.empty()) tables().push_back({title, {}});
+    std::cout << "\n----- " << title << " -----" << std::endl;
+    std::cout << std::setw(12) << "median(ns)" << std::setw(10) << "MAD"
+              << std::setw(10) << "min" << std::setw(24) << "95% CI"
+              << std::setw(14) << "iters" << "  name" << std::endl;
+}
+
+inline void printRow(const Result& r) {
+    if (!config().jsonPath.empty()) {
+        if (tables().empty()) tables().push_back({"", {}});
+        tables().back().rows.push_back(r);
+    }
+    std::ostringstream ci;
+    ci << std::fixed << std::setprecision(3) << "[" << r.ciLow << ", " << r.ciHigh << "]";
+    std::cout << std::fixed << std::setprecision(3) << std::setw(12) << r.median
+              << std::setw(10) << r.mad << std::setw(10) << r.min
+              << std::setw(24) << ci.str() << std::setw(14) << r.iterations
+              << "  " << r.name << std::endl;
+    bool hasCounters = false;
+    for (bool v : r.counters.valid) hasCounters = hasCounters || v;
+    if (hasCounters) {
+        std::cout << std::setw(12) << "" << "  per-op:";
+        r.counters.print(std::cout);
+        std::cout << std::endl;
+    }
+}
+
+} // namespace bench
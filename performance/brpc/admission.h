@@ -0,0 +1,53 @@
+#pragma once
+// 基于排队时延的准入控制，CoDel 思路（参考 folly::Codel 的服务端用法）。
+// 每个间隔（interval）内记录观察到的最小时延；间隔结束时若最小时延仍超过目标
+// （target），说明队列里有消除不掉的积压，进入过载状态，否则退出过载。
+// 过载状态下，时延超过 2 * target 的请求直接拒绝，用一个很小的过载回复代替正常处理，
+// 让积压尽快排空，尾延迟保持有界。
+//
+// 时延取 "处理时刻 - 请求中的发送时刻"：客户端把 steady_clock 的 μs 写在 EchoRequest.id，
+// 服务端用同一个单调时钟读当前时间，因此要求两端在同一台机器上（本例如此）。
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string_view>
+
+// 过载回复的 EchoResponse.message，客户端据此区分拒绝和正常回复
+constexpr std::string_view kOverloadedMessage = "OVERLOADED";
+
+class CoDelAdmission {
+public:
+    static constexpr int64_t kNoLimit = std::numeric_limits<int64_t>::max();
+
+    CoDelAdmission(int64_t target_us, int64_t interval_us)
+        : _target_us(target_us), _interval_us(interval_us) {}
+
+    // 当前拒绝阈值：未过载时为 kNoLimit。每批读一次，不加锁
+    int64_t threshold_us() const { return _threshold_us.load(std::memory_order_relaxed); }
+
+    // 每批处理完后用本批最小时延更新窗口，只在这里加锁（每批一次）
+    void update(int64_t now_us, int64_t batch_min_delay_us) {
+        std::lock_guard<std::mutex> lock(_mu);
+        if (now_us >= _interval_end_us) {
+            bool overloaded = _interval_end_us != 0 && _min_delay_us > _target_us;
+            _threshold_us.store(overloaded ? 2 * _target_us : kNoLimit, std::memory_order_relaxed);
+            _min_delay_us = batch_min_delay_us;
+            _interval_end_us = now_us + _interval_us;
+        } else {
+            _min_delay_us = std::min(_min_delay_us, batch_min_delay_us);
+        }
+    }
+
+    bool overloaded() const { return threshold_us() != kNoLimit; }
+
+private:
+    const int64_t _target_us;
+    const int64_t _interval_us;
+    std::atomic<int64_t> _threshold_us{kNoLimit};
+    std::mutex _mu;
+    int64_t _min_delay_us = kNoLimit;
+    int64_t _interval_end_us = 0;
+};
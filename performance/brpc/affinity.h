@@ -0,0 +1,68 @@
+#pragma once
+// 绑核工具：解析 CPU 列表（如 "0-3,8,10-11"），把线程或 bthread worker 绑到指定 CPU 上，
+// 避免调度器迁移线程带来的缓存失效和唤醒延迟。
+// bthread worker 的绑定通过 bthread_set_worker_startfn 完成，必须在创建第一个 bthread
+// （启动 Server / 初始化 Channel）之前调用；worker 按启动顺序轮流绑到列表中的 CPU。
+
+#include <bthread/unstable.h>
+#include <butil/logging.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 解析失败返回空列表
+inline std::vector<int> parseCpuList(const std::string& spec) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        pos = end + 1;
+        if (item.empty()) continue;
+        char* rest = nullptr;
+        long lo = std::strtol(item.c_str(), &rest, 10);
+        long hi = lo;
+        if (*rest == '-') hi = std::strtol(rest + 1, &rest, 10);
+        if (*rest != '\0' || lo < 0 || hi < lo || hi >= CPU_SETSIZE) {
+            LOG(ERROR) << "Invalid CPU list: " << spec;
+            return {};
+        }
+        for (long c = lo; c <= hi; ++c) cpus.push_back(static_cast<int>(c));
+    }
+    return cpus;
+}
+
+// 把当前线程限制在 cpus 内（列表为空时不做任何事）
+inline bool pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) LOG(ERROR) << "pthread_setaffinity_np failed: " << rc;
+    return rc == 0;
+}
+
+inline std::vector<int>& workerCpus() {
+    static std::vector<int> cpus;
+    return cpus;
+}
+
+// 每个 worker 启动时调用一次：第 i 个 worker 绑到 cpus[i % n]
+inline void pinWorkerOnStart() {
+    static std::atomic<size_t> next{0};
+    const std::vector<int>& cpus = workerCpus();
+    size_t i = next.fetch_add(1, std::memory_order_relaxed);
+    pinCurrentThread({cpus[i % cpus.size()]});
+}
+
+inline bool pinBthreadWorkers(const std::vector<int>& cpus) {
+    if (cpus.empty()) return true;
+    workerCpus() = cpus;
+    return bthread_set_worker_startfn(pinWorkerOnStart) == 0;
+}
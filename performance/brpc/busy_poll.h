@@ -0,0 +1,133 @@
+#pragma once
+// 忙轮询接收：流回调（运行在负责 I/O 的 bthread worker 上）只把消息搬进有界无锁队列
+// （Vyukov MPSC）就返回，一个绑核的 pthread 自旋取出并按批调用处理函数。
+// 消费端不经过 futex 唤醒，也不会被迁移，代价是独占一个核；I/O 和处理因此落在不同的核上。
+// 队列满时生产端让出 bthread 等待（背压），不丢消息。
+
+#include <brpc/stream.h>
+#include <bthread/bthread.h>
+#include <butil/iobuf.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+
+class BusyPollQueue {
+public:
+    // 与 StreamInputHandler::on_received_messages 相同的批处理签名
+    using Handler = std::function<void(brpc::StreamId, butil::IOBuf* const[], size_t)>;
+
+    static const size_t kMaxBatch = 64;
+
+    BusyPollQueue(size_t capacity, std::vector<int> cpus, Handler handler)
+        : _slots(roundUpPow2(capacity)), _mask(_slots.size() - 1),
+          _handler(std::move(handler)), _cpus(std::move(cpus)) {
+        for (size_t i = 0; i < _slots.size(); ++i) _slots[i].seq.store(i, std::memory_order_relaxed);
+        _poller = std::thread([this] { run(); });
+    }
+
+    BusyPollQueue(const BusyPollQueue&) = delete;
+    BusyPollQueue& operator=(const BusyPollQueue&) = delete;
+
+    // 退出前处理完已入队的消息
+    ~BusyPollQueue() {
+        _stopping.store(true, std::memory_order_release);
+        _poller.join();
+    }
+
+    // 消息内容被 swap 进队列，调用方的 IOBuf 变为空
+    void push(brpc::StreamId stream, butil::IOBuf* const messages[], size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            Slot* s;
+            while ((s = claim()) == nullptr) bthread_yield();
+            s->stream = stream;
+            s->buf.swap(*messages[i]);
+            s->seq.store(s->pos + 1, std::memory_order_release);
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> seq{0};
+        size_t pos = 0;
+        brpc::StreamId stream = 0;
+        butil::IOBuf buf;
+    };
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 2;
+        while (p < n) p *= 2;
+        return p;
+    }
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    Slot* claim() {
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& s = _slots[pos & _mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            auto dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (dif == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.pos = pos;
+                    return &s;
+                }
+            } else if (dif < 0) {
+                return nullptr;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 取出同一个流上连续的就绪消息，最多 kMaxBatch 条为一批
+    void run() {
+        pinCurrentThread(_cpus);
+        butil::IOBuf bufs[kMaxBatch];
+        butil::IOBuf* ptrs[kMaxBatch];
+        for (size_t i = 0; i < kMaxBatch; ++i) ptrs[i] = &bufs[i];
+        size_t pos = 0;
+        while (true) {
+            size_t n = 0;
+            brpc::StreamId stream = 0;
+            while (n < kMaxBatch) {
+                Slot& s = _slots[pos & _mask];
+                if (s.seq.load(std::memory_order_acquire) != pos + 1) break;
+                if (n > 0 && s.stream != stream) break;
+                stream = s.stream;
+                bufs[n++].swap(s.buf);
+                s.seq.store(pos + _mask + 1, std::memory_order_release);
+                ++pos;
+            }
+            if (n > 0) {
+                _handler(stream, ptrs, n);
+                for (size_t i = 0; i < n; ++i) bufs[i].clear();
+                continue;
+            }
+            if (_stopping.load(std::memory_order_acquire) &&
+                _enqueue_pos.load(std::memory_order_acquire) == pos) {
+                return;
+            }
+            cpuRelax();
+        }
+    }
+
+    std::vector<Slot> _slots;
+    size_t _mask;
+    Handler _handler;
+    std::vector<int> _cpus;
+    alignas(64) std::atomic<size_t> _enqueue_pos{0};
+    std::atomic<bool> _stopping{false};
+    std::thread _poller;
+};
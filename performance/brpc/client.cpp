@@ -36,6 +36,8 @@ Max: 4300
 QPS: 83814
 Total count: 3500000
 
+以上是早期手工粘贴的结果。现在用 --histogram_log=run.hlog 保存每次运行的区间直方图，
+用 histogram_tool summary / merge / compare 查看、合并多个客户端、对比两次运行。
 */
 
 
@@ -44,12 +46,22 @@ Total count: 3500000
 #include <butil/logging.h>
 #include <brpc/channel.h>
 #include <brpc/stream.h>
+#include <bthread/countdown_event.h>
 #include "echo.pb.h"
+#include "admission.h"
+#include "affinity.h"
+#include "busy_poll.h"
+#include "latency_histogram.h"
+#include "../perf_counter.h"
+#include "../../template/print_async.h"
+#include "../../template/serialize.h"
 
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <memory>
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -59,52 +71,23 @@ Total count: 3500000
 // 全局原子变量，用于统计发送和接收的消息数
 std::atomic<int64_t> g_sent_count{0};
 std::atomic<int64_t> g_recv_count{0};
-
-// 用于统计延迟的直方图（单位：μs）
-class LatencyHistogram {
- public:
-  LatencyHistogram() : total_(0), max_(0) {
-    uint64_t cur = 1;
-    const uint64_t max_bound = 10000000000ULL;  // 10秒 = 10_000_000_000μs
-    while (cur < max_bound) {
-      boundaries_.push_back(cur);
-      uint64_t next = static_cast<uint64_t>(std::ceil(cur * 1.2));
-      if (next <= cur) break;
-      cur = next;
-    }
-    boundaries_.push_back(max_bound);
-    counts_.resize(boundaries_.size(), 0);
-  }
-
-  void record(uint64_t micros) {
-    size_t idx = 0;
-    while (idx < boundaries_.size() && micros > boundaries_[idx]) ++idx;
-    if (idx >= counts_.size()) idx = counts_.size() - 1;
-    ++counts_[idx];
-    ++total_;
-    if (micros > max_) max_ = micros;
-  }
-
-  uint64_t quantile(double q) const {
-    if (total_ == 0) return 0;
-    uint64_t target = static_cast<uint64_t>(std::ceil(total_ * q));
-    uint64_t sum = 0;
-    for (size_t i = 0; i < counts_.size(); ++i) {
-      sum += counts_[i];
-      if (sum >= target) return boundaries_[i];
-    }
-    return boundaries_.back();
-  }
-
-  uint64_t max() const { return max_; }
-  uint64_t total() const { return total_; }
-
- private:
-  std::vector<uint64_t> boundaries_;
-  std::vector<uint64_t> counts_;
-  uint64_t total_;
-  uint64_t max_;
-};
+// 服务端因过载拒绝的回复数（不计入延迟直方图）
+std::atomic<int64_t> g_overloaded_count{0};
+
+DEFINE_bool(perf_counters, false, "Count hardware events (cycles, cache/TLB misses...) in the receive callback");
+DEFINE_string(histogram_out, "", "Write the latency histogram on exit; MessagePack if the path ends with .msgpack, JSON otherwise");
+DEFINE_string(histogram_log, "", "Write per-interval latency histograms to this versioned log (see histogram_tool)");
+DEFINE_int32(histogram_log_interval_s, 10, "Interval (seconds) of each --histogram_log entry");
+DEFINE_string(histogram_log_tag, "", "Free-form tag written to the --histogram_log header, e.g. host or run name");
+DEFINE_int32(num_threads, 0, "Number of bthread workers (bthread_setconcurrency), 0 keeps brpc's default");
+DEFINE_string(worker_cpus, "", "CPU list (e.g. 0-3,8) to pin bthread workers to, one CPU per worker in start order");
+DEFINE_string(sender_cpus, "", "CPU list for the sender thread");
+DEFINE_bool(busy_poll, false, "Hand replies to a dedicated spinning receiver thread instead of handling them on bthread workers");
+DEFINE_string(poll_cpus, "", "CPU list for the busy-poll receiver thread, keep disjoint from --worker_cpus and --sender_cpus");
+DEFINE_int32(poll_queue_size, 65536, "Capacity (messages) of the busy-poll queue");
+
+// 接收回调中的硬件计数，跨 bthread worker 汇总
+perf::Accumulator g_recv_counters;
 
 // 固定2KB消息大小
 const size_t MESSAGE_SIZE = 2048;
@@ -151,11 +134,59 @@ public:
     // send_times 数组用于记录每个 msg_id 对应的发送时间（本例中未再使用）
     ClientStreamReceiver(LatencyHistogram* histogram,
                          std::vector<uint64_t>* send_times)
-        : histogram_(histogram), send_times_(send_times), start_time_(get_current_time_us()) {}
+        : histogram_(histogram), send_times_(send_times), start_time_(get_current_time_us()),
+          interval_start_(start_time_) {
+        if (!FLAGS_histogram_log.empty()) {
+            log_.reset(new std::ofstream(FLAGS_histogram_log));
+            if (!*log_) {
+                LOG(ERROR) << "Failed to open " << FLAGS_histogram_log;
+                log_.reset();
+            } else {
+                double now_s = std::chrono::duration<double>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                write_histogram_log_header<DefaultLatencyBuckets>(*log_, now_s, FLAGS_histogram_log_tag);
+            }
+        }
+        if (FLAGS_busy_poll) {
+            poller_.reset(new BusyPollQueue(
+                FLAGS_poll_queue_size, parseCpuList(FLAGS_poll_cpus),
+                [this](brpc::StreamId stream, butil::IOBuf* const messages[], size_t size) {
+                    process(stream, messages, size);
+                }));
+        }
+    }
 
+    // --busy_poll 时 worker 只负责 I/O，回复交给绑核的接收线程
     virtual int on_received_messages(brpc::StreamId stream,
                                      butil::IOBuf* const messages[],
                                      size_t size) override {
+        if (poller_) {
+            poller_->push(stream, messages, size);
+        } else {
+            process(stream, messages, size);
+        }
+        return 0;
+    }
+
+    // StreamClose 是异步的，on_closed 之后才不会再有回调进来；stop_polling / flush_log 之前先等它
+    void wait_closed() { closed_.wait(); }
+
+    // 处理完已入队的回复后停止接收线程
+    void stop_polling() { poller_.reset(); }
+
+    // 写出当前区间（退出时调用，写最后一个不完整的区间）。
+    // 由 process 调用，或在 wait_closed + stop_polling 之后调用，此时不会再有 process 并发执行
+    void flush_log(uint64_t now_us) {
+        if (!log_) return;
+        write_histogram_log_interval(*log_, (interval_start_ - start_time_) / 1e6,
+                                     (now_us - interval_start_) / 1e6, interval_);
+        log_->flush();
+        interval_.reset();
+        interval_start_ = now_us;
+    }
+
+    void process(brpc::StreamId stream, butil::IOBuf* const messages[], size_t size) {
+        perf::Scope perf_scope(g_recv_counters, FLAGS_perf_counters);
         for (size_t i = 0; i < size; i++) {
             std::string data;
             data.resize(messages[i]->size());
@@ -165,26 +196,42 @@ public:
                 LOG(ERROR) << "Failed to parse EchoResponse";
                 continue;
             }
+            // 更新接收计数（过载回复同样释放一个发送配额）
+            g_recv_count.fetch_add(1, std::memory_order_relaxed);
+            if (resp.message() == kOverloadedMessage) {
+                g_overloaded_count.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
             int64_t send_time = resp.id();
             uint64_t recv_time = get_current_time_us();
             uint64_t latency = recv_time - send_time;
             histogram_->record(latency);
-            // 更新接收计数
-            g_recv_count.fetch_add(1, std::memory_order_relaxed);
+            if (log_) {
+                interval_.record(latency);
+                if (recv_time - interval_start_ >= (uint64_t)FLAGS_histogram_log_interval_s * 1000000) {
+                    flush_log(recv_time);
+                }
+            }
 
             // 每收到一定数量的回复，打印延迟统计信息
             if (histogram_->total() % 500000 == 0) {
-                std::cout << "Latency statistics (μs):" << std::endl;
-                std::cout << "Median: " << histogram_->quantile(0.5) << std::endl;
-                std::cout << "90th percentile: " << histogram_->quantile(0.9) << std::endl;
-                std::cout << "99th percentile: " << histogram_->quantile(0.99) << std::endl;
-                std::cout << "Max: " << histogram_->max() << std::endl;
+                // 回调线程只负责格式化并入队，写终端由 async_sink 的后台线程完成
+                aprint("Latency statistics (μs):");
+                aprint("Median:", histogram_->quantile(0.5));
+                aprint("90th percentile:", histogram_->quantile(0.9));
+                aprint("99th percentile:", histogram_->quantile(0.99));
+                aprint("Max:", histogram_->max());
                 double elapsed = (get_current_time_us() - start_time_) / 1000000.0;
-                std::cout << "QPS: " << histogram_->total() / elapsed << std::endl;
-                std::cout << "Total count: " << histogram_->total() << std::endl;
+                aprint("QPS:", histogram_->total() / elapsed);
+                aprint("Total count:", histogram_->total());
+                aprint("Overloaded:", g_overloaded_count.load(std::memory_order_relaxed));
+                if (FLAGS_perf_counters) {
+                    std::ostringstream counters;
+                    g_recv_counters.print(counters, histogram_->total());
+                    aprint("Per-message counters:", counters.str().c_str());
+                }
             }
         }
-        return 0;
     }
 
     virtual void on_idle_timeout(brpc::StreamId id) override {
@@ -192,12 +239,20 @@ public:
     }
     virtual void on_closed(brpc::StreamId id) override {
         LOG(INFO) << "Client stream closed: " << id;
+        closed_.signal();
     }
 
 private:
     LatencyHistogram* histogram_;
     std::vector<uint64_t>* send_times_;
     uint64_t start_time_;
+    // --histogram_log：当前区间的直方图和起点
+    std::unique_ptr<std::ofstream> log_;
+    LatencyHistogram interval_;
+    uint64_t interval_start_;
+    std::unique_ptr<BusyPollQueue> poller_;
+    // 只有一个流，on_closed 时计数归零
+    bthread::CountdownEvent closed_{1};
 };
 
 DEFINE_bool(send_attachment, true, "Carry attachment along with requests");
@@ -209,6 +264,20 @@ DEFINE_int32(max_retry, 3, "Max retries (not including the first RPC)");
 int main(int argc, char* argv[]) {
     // 解析命令行参数
     GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+    if (FLAGS_histogram_log_interval_s <= 0) {
+         LOG(ERROR) << "--histogram_log_interval_s must be positive";
+         return -1;
+    }
+
+    // worker 数量和绑核必须在第一个 bthread 创建（Channel 初始化）之前设置
+    if (!pinBthreadWorkers(parseCpuList(FLAGS_worker_cpus))) {
+         LOG(ERROR) << "Failed to pin bthread workers";
+         return -1;
+    }
+    if (FLAGS_num_threads > 0 && bthread_setconcurrency(FLAGS_num_threads) != 0) {
+         LOG(ERROR) << "Failed to set bthread concurrency to " << FLAGS_num_threads;
+         return -1;
+    }
 
     // 创建并初始化 Channel
     brpc::Channel channel;
@@ -257,6 +326,7 @@ int main(int argc, char* argv[]) {
 
     // 启动一个独立的发送线程，负责后续发送请求
     std::thread sender_thread([stream]() {
+        pinCurrentThread(parseCpuList(FLAGS_sender_cpus));
         while (!brpc::IsAskedToQuit()) {
             // 当发送与接收之间的差值超过10000时，等待一段时间
             if (g_sent_count.load(std::memory_order_relaxed) - 
@@ -278,7 +348,8 @@ int main(int argc, char* argv[]) {
          std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
-    if (brpc::StreamClose(stream) != 0) {
+    bool closing = brpc::StreamClose(stream) == 0;
+    if (!closing) {
          LOG(ERROR) << "Failed to close stream";
     }
     LOG(INFO) << "Client is going to quit";
@@ -287,5 +358,29 @@ int main(int argc, char* argv[]) {
     if (sender_thread.joinable()) {
          sender_thread.join();
     }
+    // 关闭失败时 on_closed 可能永远不来，不再等待
+    if (closing) {
+         client_receiver.wait_closed();
+    }
+    client_receiver.stop_polling();
+    client_receiver.flush_log(get_current_time_us());
+
+    if (!FLAGS_histogram_out.empty()) {
+        FILE* fp = fopen(FLAGS_histogram_out.c_str(), "wb");
+        if (!fp) {
+            LOG(ERROR) << "Failed to open " << FLAGS_histogram_out;
+        } else {
+            {
+                print_buffer out(fp);
+                const std::string& path = FLAGS_histogram_out;
+                if (path.size() >= 8 && path.compare(path.size() - 8, 8, ".msgpack") == 0) {
+                    write_msgpack(out, histogram);
+                } else {
+                    write_json(out, histogram);
+                }
+            }
+            fclose(fp);
+        }
+    }
     return 0;
 }
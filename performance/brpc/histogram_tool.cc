@@ -0,0 +1,227 @@
+// 延迟直方图日志工具（日志格式见 latency_histogram.h，由 client --histogram_log 生成）
+//
+//   summary LOG...                 每个日志及合并后的分位数
+//   merge -o OUT LOG...            合并多个客户端/进程的日志：区间按各自的起始时间对齐到同一时间轴
+//   compare BASE NEW [--max_regression=PCT] [--confidence=C]
+//                                  逐分位数对比两次运行：差值、相对变化、基于次序统计量的置信区间，
+//                                  区间不重叠视为显著；另给出整体分布的两样本 KS 检验。
+//                                  存在显著且超过 PCT%（默认 5）的变慢时退出码为 1，可用于发布卡点。
+//
+// 编译：g++ -O2 -std=c++17 histogram_tool.cc -o histogram_tool
+// 运行：./histogram_tool compare base.hlog new.hlog --max_regression=3
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.h"
+
+using namespace std;
+
+using Log = HistogramLog<>;
+
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+bool load(const string& path, Log* log) {
+    ifstream in(path);
+    if (!in) {
+        cerr << path << ": cannot open" << endl;
+        return false;
+    }
+    string error;
+    if (!read_histogram_log(in, log, &error)) {
+        cerr << path << ": " << error << endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadAll(const vector<string>& paths, vector<Log>* logs) {
+    for (const string& p : paths) {
+        logs->emplace_back();
+        if (!load(p, &logs->back())) return false;
+    }
+    return true;
+}
+
+// 标准正态分布的分位数（Abramowitz & Stegun 26.2.23，误差 < 4.5e-4）
+double normalQuantile(double p) {
+    double q = p < 0.5 ? p : 1 - p;
+    double t = sqrt(-2 * log(q));
+    double z = t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+                       (1 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+    return p < 0.5 ? -z : z;
+}
+
+// 分位数 q 的置信区间：二项分布正态近似下的次序统计量秩区间（与 bench.h 中位数 CI 同一思路）
+pair<uint64_t, uint64_t> quantileCi(const LatencyHistogram& h, double q, double z) {
+    double n = (double)h.total();
+    double center = n * q;
+    double half = z * sqrt(n * q * (1 - q));
+    uint64_t lo = (uint64_t)max(1.0, floor(center - half));
+    uint64_t hi = (uint64_t)min(n, ceil(center + half) + 1);
+    return {h.value_at_rank(lo), h.value_at_rank(hi)};
+}
+
+// Kolmogorov 分布的上尾概率 Q(λ) = 2 Σ (-1)^(j-1) exp(-2 j² λ²)（Numerical Recipes probks）。
+// λ 很小时级数收敛极慢、截断后接近 0，而真实值趋于 1：Q(0.2) 与 1 相差不到 1e-10，直接返回 1；
+// 100 项内未收敛同样返回 1
+double probKs(double lambda) {
+    if (lambda < 0.2) return 1;
+    double a2 = -2.0 * lambda * lambda, fac = 2, sum = 0, prev = 0;
+    for (int j = 1; j <= 100; ++j) {
+        double term = fac * exp(a2 * j * j);
+        sum += term;
+        if (fabs(term) <= 0.001 * prev || fabs(term) <= 1e-8 * sum) return min(1.0, max(0.0, sum));
+        fac = -fac;
+        prev = fabs(term);
+    }
+    return 1;
+}
+
+// 两样本 KS 检验：D 取各桶上界处累积分布之差的最大值，p 值用渐近 Kolmogorov 分布
+pair<double, double> ksTest(const LatencyHistogram& a, const LatencyHistogram& b) {
+    double na = (double)a.total(), nb = (double)b.total();
+    double ca = 0, cb = 0, d = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        ca += a.counts()[i];
+        cb += b.counts()[i];
+        d = max(d, fabs(ca / na - cb / nb));
+    }
+    double ne = sqrt(na * nb / (na + nb));
+    return {d, probKs((ne + 0.12 + 0.11 / ne) * d)};
+}
+
+void printSummary(const string& name, const LatencyHistogram& h) {
+    printf("%-32s %12llu", name.c_str(), (unsigned long long)h.total());
+    for (double q : kQuantiles) printf(" %10llu", (unsigned long long)h.quantile(q));
+    printf(" %10llu\n", (unsigned long long)h.max());
+}
+
+int summary(const vector<string>& paths) {
+    vector<Log> logs;
+    if (paths.empty() || !loadAll(paths, &logs)) return 2;
+    printf("%-32s %12s %10s %10s %10s %10s %10s\n", "log", "count", "p50", "p90", "p99",
+           "p99.9", "max");
+    LatencyHistogram all;
+    for (size_t i = 0; i < logs.size(); ++i) {
+        LatencyHistogram h = logs[i].total();
+        printSummary(paths[i], h);
+        all.merge(h);
+    }
+    if (logs.size() > 1) printSummary("(merged)", all);
+    return 0;
+}
+
+int merge(const string& outPath, const vector<string>& paths) {
+    vector<Log> logs;
+    if (paths.empty() || !loadAll(paths, &logs)) return 2;
+    Log merged;
+    merged.start_s = logs[0].start_s;
+    for (const Log& l : logs) merged.start_s = min(merged.start_s, l.start_s);
+    for (const Log& l : logs) {
+        if (!l.tag.empty()) merged.tag += (merged.tag.empty() ? "" : "+") + l.tag;
+        for (Log::Interval i : l.intervals) {
+            i.offset_s += l.start_s - merged.start_s;
+            merged.intervals.push_back(std::move(i));
+        }
+    }
+    stable_sort(merged.intervals.begin(), merged.intervals.end(),
+                [](const Log::Interval& a, const Log::Interval& b) { return a.offset_s < b.offset_s; });
+    ofstream out(outPath);
+    write_histogram_log(out, merged);
+    if (!out) {
+        cerr << outPath << ": write failed" << endl;
+        return 2;
+    }
+    printf("%-32s %12s %10s %10s %10s %10s %10s\n", "log", "count", "p50", "p90", "p99",
+           "p99.9", "max");
+    printSummary(outPath, merged.total());
+    return 0;
+}
+
+int compare(const string& basePath, const string& newPath, double maxRegressionPct,
+            double confidence) {
+    Log baseLog, newLog;
+    if (!load(basePath, &baseLog) || !load(newPath, &newLog)) return 2;
+    LatencyHistogram a = baseLog.total(), b = newLog.total();
+    if (a.total() == 0 || b.total() == 0) {
+        cerr << "empty histogram" << endl;
+        return 2;
+    }
+    double z = normalQuantile(0.5 + confidence / 2);
+    printf("base: %s (%llu samples)\nnew:  %s (%llu samples)\n\n", basePath.c_str(),
+           (unsigned long long)a.total(), newPath.c_str(), (unsigned long long)b.total());
+    printf("%-8s %10s %10s %10s %9s %23s %23s  %s\n", "", "base", "new", "delta", "delta%",
+           "base CI", "new CI", "significant");
+    bool regressed = false;
+    for (double q : kQuantiles) {
+        uint64_t va = a.quantile(q), vb = b.quantile(q);
+        auto ca = quantileCi(a, q, z), cb = quantileCi(b, q, z);
+        bool significant = ca.second < cb.first || cb.second < ca.first;
+        double pct = 100.0 * ((double)vb - (double)va) / (double)va;
+        bool bad = significant && vb > va && pct > maxRegressionPct;
+        regressed = regressed || bad;
+        char label[16], ciA[32], ciB[32];
+        snprintf(label, sizeof(label), "p%g", q * 100);
+        snprintf(ciA, sizeof(ciA), "[%llu, %llu]", (unsigned long long)ca.first,
+                 (unsigned long long)ca.second);
+        snprintf(ciB, sizeof(ciB), "[%llu, %llu]", (unsigned long long)cb.first,
+                 (unsigned long long)cb.second);
+        printf("%-8s %10llu %10llu %+10lld %+8.1f%% %23s %23s  %s\n", label,
+               (unsigned long long)va, (unsigned long long)vb, (long long)vb - (long long)va, pct,
+               ciA, ciB, bad ? "yes (REGRESSION)" : significant ? "yes" : "no");
+    }
+    printf("%-8s %10llu %10llu %+10lld\n", "max", (unsigned long long)a.max(),
+           (unsigned long long)b.max(), (long long)b.max() - (long long)a.max());
+    auto ks = ksTest(a, b);
+    printf("\nKS test: D = %.4f, p = %.3g (%s at %.0f%% confidence)\n", ks.first, ks.second,
+           ks.second < 1 - confidence ? "distributions differ" : "no significant difference",
+           confidence * 100);
+    printf("桶宽约 20%%，分位数为所在桶的上界；小于一个桶宽的变化无法分辨。\n");
+    if (regressed) {
+        printf("\nREGRESSION: a significant percentile is more than %.1f%% slower\n",
+               maxRegressionPct);
+    }
+    return regressed ? 1 : 0;
+}
+
+int usage() {
+    cerr << "usage: histogram_tool summary LOG...\n"
+            "       histogram_tool merge -o OUT LOG...\n"
+            "       histogram_tool compare BASE NEW [--max_regression=PCT] [--confidence=C]\n";
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) return usage();
+    string cmd = argv[1];
+    vector<string> args(argv + 2, argv + argc);
+    if (cmd == "summary") return summary(args);
+    if (cmd == "merge") {
+        if (args.size() < 3 || args[0] != "-o") return usage();
+        return merge(args[1], vector<string>(args.begin() + 2, args.end()));
+    }
+    if (cmd == "compare") {
+        double maxRegression = 5, confidence = 0.99;
+        vector<string> paths;
+        for (const string& a : args) {
+            if (a.rfind("--max_regression=", 0) == 0) {
+                maxRegression = atof(a.c_str() + strlen("--max_regression="));
+            } else if (a.rfind("--confidence=", 0) == 0) {
+                confidence = atof(a.c_str() + strlen("--confidence="));
+            } else {
+                paths.push_back(a);
+            }
+        }
+        if (paths.size() != 2 || confidence <= 0 || confidence >= 1) return usage();
+        return compare(paths[0], paths[1], maxRegression, confidence);
+    }
+    return usage();
+}
@@ -0,0 +1,279 @@
+#pragma once
+// 延迟直方图（单位：μs），桶边界在编译期生成。
+// GeometricBuckets<Num, Den, MaxBound>：b[0] = 1，b[i+1] = ceil(b[i] * Num / Den)，
+// 直到 >= MaxBound，最后一个桶的上界为 MaxBound。值 v 落入第一个 v <= b[i] 的桶。
+// 边界表和按 floor(log2(v)) 分组的反向索引表都是 static constexpr std::array，
+// 所有直方图实例共享，构造时只需清零计数。
+//
+// 直方图日志（文本，按时间区间记录，思路同 HdrHistogram 的 interval log）：
+//   #latency-histogram-log 1                    格式版本
+//   #buckets geometric <Num> <Den> <MaxBound> <桶数>   桶布局不同的日志不能合并
+//   #start <unix 秒>                             第一个区间的起点
+//   #tag <任意文本>                              可选，如主机名/进程
+//   <起点偏移秒> <区间长度秒> <total> <max> <桶号>:<计数>,...   每个区间一行，只写非零桶
+// 合并与对比见 histogram_tool.cc。
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+template <uint64_t Num, uint64_t Den, uint64_t MaxBound>
+struct GeometricBuckets {
+  static_assert(Num > Den && Den > 0, "growth factor must be > 1");
+  static_assert(MaxBound > 1, "range must be > 1");
+  static_assert(MaxBound <= ~uint64_t(0) / Num, "cur * Num must not overflow");
+
+  static constexpr uint64_t num = Num;
+  static constexpr uint64_t den = Den;
+  static constexpr uint64_t max_bound = MaxBound;
+
+  // 整数运算的 ceil(cur * Num / Den)，增长不足 1 时至少 +1
+  static constexpr uint64_t next(uint64_t cur) {
+    uint64_t n = (cur * Num + Den - 1) / Den;
+    return n > cur ? n : cur + 1;
+  }
+
+  static constexpr size_t countBuckets() {
+    size_t n = 0;
+    for (uint64_t cur = 1; cur < MaxBound; cur = next(cur)) ++n;
+    return n + 1;
+  }
+
+  static constexpr size_t count = countBuckets();
+
+  static constexpr std::array<uint64_t, count> makeBoundaries() {
+    std::array<uint64_t, count> b{};
+    uint64_t cur = 1;
+    for (size_t i = 0; i + 1 < count; ++i) {
+      b[i] = cur;
+      cur = next(cur);
+    }
+    b[count - 1] = MaxBound;
+    return b;
+  }
+
+  static constexpr std::array<uint64_t, count> boundaries = makeBoundaries();
+
+  // first[k]：第一个 b[i] >= 2^k 的桶；[2^k, 2^(k+1)) 内的值从这里开始最多前进几个桶
+  static constexpr std::array<uint16_t, 65> makeLog2First() {
+    std::array<uint16_t, 65> first{};
+    size_t i = 0;
+    for (int k = 0; k < 65; ++k) {
+      uint64_t lo = k < 64 ? uint64_t(1) << k : ~uint64_t(0);
+      while (i + 1 < count && boundaries[i] < lo) ++i;
+      first[k] = static_cast<uint16_t>(i);
+    }
+    return first;
+  }
+
+  static constexpr std::array<uint16_t, 65> log2First = makeLog2First();
+
+  static size_t index(uint64_t v) {
+    int k = v ? 63 - __builtin_clzll(v) : 0;
+    size_t i = log2First[k];
+    while (i + 1 < count && v > boundaries[i]) ++i;
+    return i;
+  }
+};
+
+// 与原实现相同的参数：增长 1.2 倍，上界 10 秒
+using DefaultLatencyBuckets = GeometricBuckets<12, 10, 10000000000ULL>;
+
+template <typename Buckets = DefaultLatencyBuckets>
+class BasicLatencyHistogram {
+ public:
+  static constexpr size_t kBuckets = Buckets::count;
+
+  void record(uint64_t micros) {
+    ++counts_[Buckets::index(micros)];
+    ++total_;
+    if (micros > max_) max_ = micros;
+  }
+
+  uint64_t quantile(double q) const {
+    if (total_ == 0) return 0;
+    return value_at_rank(static_cast<uint64_t>(std::ceil(total_ * q)));
+  }
+
+  // 第 rank 小（从 1 开始）的值所在桶的上界
+  uint64_t value_at_rank(uint64_t rank) const {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      sum += counts_[i];
+      if (sum >= rank) return Buckets::boundaries[i];
+    }
+    return Buckets::boundaries.back();
+  }
+
+  // 读日志和合并用：直接累加桶计数 / 更新最大值
+  void add_bucket(size_t bucket, uint64_t n) {
+    counts_[bucket] += n;
+    total_ += n;
+  }
+  void update_max(uint64_t v) { max_ = std::max(max_, v); }
+
+  void merge(const BasicLatencyHistogram& other) {
+    for (size_t i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    update_max(other.max_);
+  }
+
+  void reset() { *this = BasicLatencyHistogram(); }
+
+  uint64_t max() const { return max_; }
+  uint64_t total() const { return total_; }
+  static constexpr const std::array<uint64_t, kBuckets>& boundaries() { return Buckets::boundaries; }
+  const std::array<uint64_t, kBuckets>& counts() const { return counts_; }
+
+  // 供 print.h / serialize.h 使用：print(h) 或 write_json(out, h)
+  auto print_fields() const { return std::tie(total_, max_, Buckets::boundaries, counts_); }
+  static constexpr std::array<std::string_view, 4> print_names = {"total", "max", "boundaries", "counts"};
+
+ private:
+  std::array<uint64_t, kBuckets> counts_{};
+  uint64_t total_ = 0;
+  uint64_t max_ = 0;
+};
+
+using LatencyHistogram = BasicLatencyHistogram<>;
+
+// ---- 直方图日志 ----
+
+constexpr int kHistogramLogVersion = 1;
+
+template <typename Buckets = DefaultLatencyBuckets>
+struct HistogramLog {
+  struct Interval {
+    double offset_s = 0;   // 相对 start_s 的起点
+    double length_s = 0;
+    BasicLatencyHistogram<Buckets> histogram;
+  };
+
+  double start_s = 0;      // unix 秒
+  std::string tag;
+  std::vector<Interval> intervals;
+
+  BasicLatencyHistogram<Buckets> total() const {
+    BasicLatencyHistogram<Buckets> h;
+    for (const Interval& i : intervals) h.merge(i.histogram);
+    return h;
+  }
+};
+
+template <typename Buckets>
+void write_histogram_log_header(std::ostream& out, double start_s, const std::string& tag) {
+  out << "#latency-histogram-log " << kHistogramLogVersion << "\n"
+      << "#buckets geometric " << Buckets::num << " " << Buckets::den << " " << Buckets::max_bound
+      << " " << Buckets::count << "\n"
+      << "#start ";
+  auto oldflags = out.flags();
+  auto oldprec = out.precision();
+  out << std::fixed << std::setprecision(6) << start_s << "\n";
+  out.flags(oldflags);
+  out.precision(oldprec);
+  if (!tag.empty()) out << "#tag " << tag << "\n";
+}
+
+template <typename Buckets>
+void write_histogram_log_interval(std::ostream& out, double offset_s, double length_s,
+                                  const BasicLatencyHistogram<Buckets>& h) {
+  auto oldflags = out.flags();
+  auto oldprec = out.precision();
+  out << std::fixed << std::setprecision(3) << offset_s << " " << length_s << " ";
+  out.flags(oldflags);
+  out.precision(oldprec);
+  out << h.total() << " " << h.max() << " ";
+  bool first = true;
+  for (size_t i = 0; i < h.kBuckets; ++i) {
+    if (h.counts()[i] == 0) continue;
+    out << (first ? "" : ",") << i << ":" << h.counts()[i];
+    first = false;
+  }
+  out << (first ? "-\n" : "\n");
+}
+
+template <typename Buckets>
+void write_histogram_log(std::ostream& out, const HistogramLog<Buckets>& log) {
+  write_histogram_log_header<Buckets>(out, log.start_s, log.tag);
+  for (const auto& i : log.intervals) {
+    write_histogram_log_interval(out, i.offset_s, i.length_s, i.histogram);
+  }
+}
+
+// 版本或桶布局不匹配、格式错误时返回 false 并给出原因
+template <typename Buckets>
+bool read_histogram_log(std::istream& in, HistogramLog<Buckets>* log, std::string* error) {
+  std::string line;
+  size_t lineno = 0;
+  bool has_version = false;
+  bool has_buckets = false;
+  auto fail = [&](const std::string& why) {
+    *error = "line " + std::to_string(lineno) + ": " + why;
+    return false;
+  };
+  while (std::getline(in, line)) {
+    ++lineno;
+    if (line.empty()) continue;
+    std::istringstream is(line);
+    if (line[0] == '#') {
+      std::string key;
+      is >> key;
+      if (key == "#latency-histogram-log") {
+        int version = 0;
+        if (!(is >> version) || version != kHistogramLogVersion) {
+          return fail("unsupported log version");
+        }
+        has_version = true;
+      } else if (key == "#buckets") {
+        std::string kind;
+        uint64_t num = 0, den = 0, max_bound = 0, count = 0;
+        is >> kind >> num >> den >> max_bound >> count;
+        if (kind != "geometric" || num != Buckets::num || den != Buckets::den ||
+            max_bound != Buckets::max_bound || count != Buckets::count) {
+          return fail("bucket layout differs from this build");
+        }
+        has_buckets = true;
+      } else if (key == "#start") {
+        is >> log->start_s;
+      } else if (key == "#tag") {
+        std::getline(is >> std::ws, log->tag);
+      }
+      continue;
+    }
+    if (!has_version || !has_buckets) return fail("missing header");
+    typename HistogramLog<Buckets>::Interval interval;
+    uint64_t total = 0, max = 0;
+    std::string counts;
+    if (!(is >> interval.offset_s >> interval.length_s >> total >> max >> counts)) {
+      return fail("malformed interval");
+    }
+    if (counts != "-") {
+      std::istringstream cs(counts);
+      std::string item;
+      while (std::getline(cs, item, ',')) {
+        std::istringstream ps(item);
+        size_t bucket = 0;
+        char colon = 0;
+        uint64_t n = 0;
+        if (!(ps >> bucket >> colon >> n) || colon != ':') return fail("malformed bucket " + item);
+        if (bucket >= Buckets::count) return fail("bucket out of range");
+        interval.histogram.add_bucket(bucket, n);
+      }
+    }
+    if (interval.histogram.total() != total) return fail("bucket counts do not sum to total");
+    interval.histogram.update_max(max);
+    log->intervals.push_back(std::move(interval));
+  }
+  if (!has_version) return fail("not a latency histogram log");
+  return true;
+}
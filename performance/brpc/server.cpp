@@ -2,65 +2,247 @@
 #include <butil/logging.h>
 #include <brpc/server.h>
 #include "echo.pb.h"
+#include "admission.h"
+#include "affinity.h"
+#include "busy_poll.h"
+#include "../perf_counter.h"
 #include <brpc/stream.h>
+#include <bthread/countdown_event.h>
+#include <butil/iobuf.h>
+#include <butil/object_pool.h>
+#include <butil/time.h>
+#include <google/protobuf/arena.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 DEFINE_bool(send_attachment, true, "Carry attachment along with response");
 DEFINE_int32(port, 8001, "TCP Port of this server");
 DEFINE_int32(idle_timeout_s, -1, "Connection will be closed if there is no "
              "read/write operations during the last `idle_timeout_s'");
+DEFINE_bool(perf_counters, false, "Count hardware events (cycles, cache/TLB misses...) in the stream handler");
+DEFINE_bool(use_arena, true, "Allocate each batch's request/response messages from a reused protobuf Arena");
+DEFINE_bool(admission_control, false, "Reject requests with an overload reply when queueing delay stays above target "
+             "(off by default: rejected requests are left out of the client's latency histogram)");
+DEFINE_int64(codel_target_us, 2000, "Target queueing delay (μs) of the CoDel admission controller");
+DEFINE_int64(codel_interval_us, 100000, "Window (μs) over which the minimum queueing delay must exceed the target");
+DEFINE_int32(num_threads, 0, "Number of bthread workers (ServerOptions::num_threads), 0 keeps brpc's default");
+DEFINE_string(worker_cpus, "", "CPU list (e.g. 0-3,8) to pin bthread workers to, one CPU per worker in start order");
+DEFINE_bool(busy_poll, false, "Hand received messages to a dedicated spinning handler thread instead of handling them on bthread workers");
+DEFINE_string(poll_cpus, "", "CPU list for the busy-poll handler thread, keep disjoint from --worker_cpus");
+DEFINE_int32(poll_queue_size, 65536, "Capacity (messages) of the busy-poll queue");
+
+// 流处理回调中的硬件计数，跨 bthread worker 汇总
+perf::Accumulator g_handler_counters;
+std::atomic<int64_t> g_handled_count{0};
+// 因过载被拒绝的请求数
+std::atomic<int64_t> g_rejected_count{0};
+
+// 每批消息共用一个 Arena。初始块随对象一起复用，Reset 后保留，
+// 批内的消息和字符串字段只在初始块不够时才向堆申请新块。
+// 对象由 butil::ObjectPool 管理（线程本地缓存，不争锁），不同 bthread 各取各的。
+struct BatchArena {
+    static const size_t kInitialBlock = 64 * 1024;
+
+    BatchArena() : block(new char[kInitialBlock]), arena(options(block.get())) {}
+
+    static google::protobuf::ArenaOptions options(char* initial) {
+        google::protobuf::ArenaOptions opts;
+        opts.initial_block = initial;
+        opts.initial_block_size = kInitialBlock;
+        return opts;
+    }
+
+    std::unique_ptr<char[]> block;
+    google::protobuf::Arena arena;
+};
+
+// Arena 统计：批数、批内实际使用的字节、超出初始块而向堆申请的次数和字节
+std::atomic<int64_t> g_arena_batches{0};
+std::atomic<int64_t> g_arena_used_bytes{0};
+std::atomic<int64_t> g_arena_heap_batches{0};
+std::atomic<int64_t> g_arena_heap_bytes{0};
 
 // StreamReceiver 实现：每当接收到消息时，将请求反序列化，构造带有相同 id 的响应后返回
+// 一批消息的请求/响应对象都从同一个 Arena 分配，批处理结束后整体释放（见 --use_arena）
+// 排队时延持续超过目标时，超时请求直接回过载标记（见 admission.h 和 --admission_control）
 class StreamReceiver : public brpc::StreamInputHandler {
 public:
+    StreamReceiver() : _admission(FLAGS_codel_target_us, FLAGS_codel_interval_us) {
+        if (FLAGS_busy_poll) {
+            _poller.reset(new BusyPollQueue(
+                FLAGS_poll_queue_size, parseCpuList(FLAGS_poll_cpus),
+                [this](brpc::StreamId id, butil::IOBuf* const messages[], size_t size) {
+                    process(id, messages, size);
+                }));
+        }
+    }
+
+    // 一批消息共用的准入状态：批开始时的时刻和拒绝阈值，处理中记录的最小时延
+    struct BatchAdmission {
+        int64_t now_us;
+        int64_t threshold_us;
+        int64_t min_delay_us;
+        int64_t rejected;
+    };
+
+    // 直接从 IOBuf 解析、序列化到 IOBuf，不经过中间 std::string
+    void handle(brpc::StreamId id, const butil::IOBuf& message,
+                example::EchoRequest* req, example::EchoResponse* resp,
+                BatchAdmission& adm) {
+        butil::IOBufAsZeroCopyInputStream in(message);
+        if (!req->ParseFromZeroCopyStream(&in)) {
+            LOG(ERROR) << "Failed to parse EchoRequest";
+            return;
+        }
+        // id 是客户端的发送时刻，差值即排队（含网络）时延
+        int64_t delay = adm.now_us - req->id();
+        adm.min_delay_us = std::min(adm.min_delay_us, delay);
+        if (delay > adm.threshold_us) {
+            // 过载：不做正常处理，只回一个带原 id 的过载标记
+            resp->set_message(kOverloadedMessage.data(), kOverloadedMessage.size());
+            ++adm.rejected;
+        } else {
+            // 构造 EchoResponse，复制 id 并设置响应消息
+            resp->set_message("Reply from server");
+        }
+        resp->set_id(req->id());
+
+        butil::IOBuf reply;
+        butil::IOBufAsZeroCopyOutputStream out(&reply);
+        if (!resp->SerializeToZeroCopyStream(&out)) {
+            LOG(ERROR) << "Failed to serialize EchoResponse";
+            return;
+        }
+        if (brpc::StreamWrite(id, reply) != 0) {
+            LOG(ERROR) << "Failed to write reply on stream " << id;
+        }
+    }
+
+    // --busy_poll 时 worker 只负责 I/O，消息交给绑核的处理线程
     virtual int on_received_messages(brpc::StreamId id, 
                                      butil::IOBuf *const messages[], 
                                      size_t size) {
-        for (size_t i = 0; i < size; ++i) {
-            std::string req_str;
-            req_str.resize(messages[i]->size());
-            messages[i]->copy_to(&req_str[0], req_str.size());
-
+        if (_poller) {
+            _poller->push(id, messages, size);
+            return 0;
+        }
+        process(id, messages, size);
+        return 0;
+    }
 
-            // 解析 EchoRequest
-            example::EchoRequest req;
-            if (!req.ParseFromString(req_str)) {
-                LOG(ERROR) << "Failed to parse EchoRequest";
-                continue;
+    void process(brpc::StreamId id, butil::IOBuf *const messages[], size_t size) {
+        perf::Scope perf_scope(g_handler_counters, FLAGS_perf_counters);
+        BatchArena* batch = FLAGS_use_arena ? butil::get_object<BatchArena>() : nullptr;
+        BatchAdmission adm = {butil::monotonic_time_us(),
+                              FLAGS_admission_control ? _admission.threshold_us() : CoDelAdmission::kNoLimit,
+                              CoDelAdmission::kNoLimit, 0};
+        for (size_t i = 0; i < size; ++i) {
+            if (batch) {
+                handle(id, *messages[i],
+                       google::protobuf::Arena::CreateMessage<example::EchoRequest>(&batch->arena),
+                       google::protobuf::Arena::CreateMessage<example::EchoResponse>(&batch->arena),
+                       adm);
+            } else {
+                example::EchoRequest req;
+                example::EchoResponse resp;
+                handle(id, *messages[i], &req, &resp, adm);
             }
-            // LOG(INFO) << "Received request: " << req.id();
-            // 构造 EchoResponse，复制 id 并设置响应消息
-            example::EchoResponse resp;
-            resp.set_message("Reply from server");
-            resp.set_id(req.id());
-
-            std::string resp_str;
-            if (!resp.SerializeToString(&resp_str)) {
-                LOG(ERROR) << "Failed to serialize EchoResponse";
-                continue;
+        }
+        if (FLAGS_admission_control && adm.min_delay_us != CoDelAdmission::kNoLimit) {
+            _admission.update(adm.now_us, adm.min_delay_us);
+        }
+        if (adm.rejected) {
+            g_rejected_count.fetch_add(adm.rejected, std::memory_order_relaxed);
+        }
+        if (batch) {
+            int64_t used = batch->arena.SpaceUsed();
+            int64_t allocated = batch->arena.Reset();
+            g_arena_batches.fetch_add(1, std::memory_order_relaxed);
+            g_arena_used_bytes.fetch_add(used, std::memory_order_relaxed);
+            if (allocated > (int64_t)BatchArena::kInitialBlock) {
+                g_arena_heap_batches.fetch_add(1, std::memory_order_relaxed);
+                g_arena_heap_bytes.fetch_add(allocated - BatchArena::kInitialBlock, std::memory_order_relaxed);
+            }
+            butil::return_object(batch);
+        }
+        int64_t handled = g_handled_count.fetch_add(size, std::memory_order_relaxed) + size;
+        if (handled / 500000 != (handled - (int64_t)size) / 500000) {
+            if (FLAGS_perf_counters) {
+                std::ostringstream os;
+                g_handler_counters.print(os, handled);
+                LOG(INFO) << "Per-message counters after " << handled << " messages:" << os.str();
+            }
+            if (FLAGS_admission_control) {
+                LOG(INFO) << "Admission after " << handled << " messages: "
+                          << g_rejected_count.load(std::memory_order_relaxed) << " rejected, "
+                          << (_admission.overloaded() ? "overloaded" : "normal");
             }
-            butil::IOBuf reply;
-            reply.append(resp_str);
-            if (brpc::StreamWrite(id, reply) != 0) {
-                LOG(ERROR) << "Failed to write reply on stream " << id;
+            if (FLAGS_use_arena) {
+                int64_t batches = g_arena_batches.load(std::memory_order_relaxed);
+                LOG(INFO) << "Arena after " << handled << " messages: "
+                          << (double)g_arena_used_bytes.load(std::memory_order_relaxed) / handled
+                          << " bytes/message, " << (double)handled / batches << " messages/batch, "
+                          << g_arena_heap_batches.load(std::memory_order_relaxed) << "/" << batches
+                          << " batches needed heap blocks ("
+                          << (double)g_arena_heap_bytes.load(std::memory_order_relaxed) / handled
+                          << " heap bytes/message)";
             }
         }
-        return 0;
     }
     virtual void on_idle_timeout(brpc::StreamId id) {
         LOG(INFO) << "Stream=" << id << " has no data transmission for a while";
     }
     virtual void on_closed(brpc::StreamId id) {
         LOG(INFO) << "Stream=" << id << " is closed";
+        {
+            std::lock_guard<std::mutex> lock(_mu);
+            _streams.erase(std::remove(_streams.begin(), _streams.end(), id), _streams.end());
+        }
+        _open_streams.signal();
+    }
+
+    // StreamClose 是异步的，on_closed 之后才不会再有回调进来。销毁本对象（及其中的 BusyPollQueue）之前
+    // close_all + wait_closed。计数在 StreamAccept 之前加上（add_stream），accept 失败时 accept_failed 退回，
+    // 因此 on_closed 再早也不会把计数减成负数。
+    // 若 on_closed 早于 accepted，该 id 会留在列表里，close_all 对它调用 StreamClose 只会失败，无其他影响
+    void add_stream() { _open_streams.add_count(1); }
+    void accept_failed() { _open_streams.signal(); }
+    void accepted(brpc::StreamId id) {
+        std::lock_guard<std::mutex> lock(_mu);
+        _streams.push_back(id);
     }
+    void close_all() {
+        std::vector<brpc::StreamId> streams;
+        {
+            std::lock_guard<std::mutex> lock(_mu);
+            streams = _streams;
+        }
+        for (brpc::StreamId id : streams) {
+            brpc::StreamClose(id);
+        }
+    }
+    void wait_closed() { _open_streams.wait(); }
+private:
+    CoDelAdmission _admission;
+    std::unique_ptr<BusyPollQueue> _poller;
+    bthread::CountdownEvent _open_streams{0};
+    // 尚未关闭的流
+    std::mutex _mu;
+    std::vector<brpc::StreamId> _streams;
 };
 
 // EchoService 服务实现：在 Echo 接口中接受 stream 并设置 StreamReceiver
 class StreamingEchoService : public example::EchoService {
 public:
-    StreamingEchoService() : _sd(brpc::INVALID_STREAM_ID) {}
+    StreamingEchoService() {}
+    // 关闭所有未关闭的流，等到它们的 on_closed 都回调完再销毁 _receiver
     virtual ~StreamingEchoService() {
-        brpc::StreamClose(_sd);
+        _receiver.close_all();
+        _receiver.wait_closed();
     }
     virtual void Echo(google::protobuf::RpcController* controller,
                       const example::EchoRequest* /*request*/,
@@ -70,20 +252,28 @@ public:
         brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
         brpc::StreamOptions stream_options;
         stream_options.handler = &_receiver;
-        if (brpc::StreamAccept(&_sd, *cntl, &stream_options) != 0) {
+        brpc::StreamId sd;
+        _receiver.add_stream();
+        if (brpc::StreamAccept(&sd, *cntl, &stream_options) != 0) {
+            _receiver.accept_failed();
             cntl->SetFailed("Fail to accept stream");
             return;
         }
+        _receiver.accepted(sd);
         response->set_message("Accepted stream");
         response->set_id(1);
     }
 private:
     StreamReceiver _receiver;
-    brpc::StreamId _sd;
 };
 
 int main(int argc, char* argv[]) {
     GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+    // 必须在第一个 bthread 创建之前设置
+    if (!pinBthreadWorkers(parseCpuList(FLAGS_worker_cpus))) {
+        LOG(ERROR) << "Fail to pin bthread workers";
+        return -1;
+    }
     brpc::Server server;
     StreamingEchoService echo_service_impl;
     if (server.AddService(&echo_service_impl, brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
@@ -92,6 +282,9 @@ int main(int argc, char* argv[]) {
     }
     brpc::ServerOptions options;
     options.idle_timeout_sec = FLAGS_idle_timeout_s;
+    if (FLAGS_num_threads > 0) {
+        options.num_threads = FLAGS_num_threads;
+    }
     if (server.Start(FLAGS_port, &options) != 0) {
         LOG(ERROR) << "Fail to start EchoServer";
         return -1;
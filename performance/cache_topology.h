@@ -0,0 +1,117 @@
+#pragma once
+// 读取本机缓存层级信息
+// 优先读取 Linux sysfs（/sys/devices/system/cpu/cpu0/cache/index*），
+// 读取失败时回退到 CPUID：Intel leaf 4，AMD leaf 0x8000001D（两者格式相同）。
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+struct CacheLevel {
+    int level = 0;
+    std::string type;        // "Data" / "Instruction" / "Unified"
+    size_t sizeBytes = 0;
+    size_t lineSize = 0;
+    std::string sharedCpus;  // sysfs 的 shared_cpu_list，CPUID 路径下为空
+    std::string source;      // "sysfs" / "cpuid"
+};
+
+namespace cache_topology_details {
+
+inline bool readLine(const std::string& path, std::string* out) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, *out));
+}
+
+// 解析 "32K" / "1024K" / "35M" 这类大小
+inline size_t parseSize(const std::string& s) {
+    size_t v = 0;
+    size_t i = 0;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') v = v * 10 + (s[i++] - '0');
+    if (i < s.size()) {
+        if (s[i] == 'K') v <<= 10;
+        else if (s[i] == 'M') v <<= 20;
+        else if (s[i] == 'G') v <<= 30;
+    }
+    return v;
+}
+
+inline std::vector<CacheLevel> fromSysfs() {
+    std::vector<CacheLevel> caches;
+    for (int i = 0;; ++i) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        std::string level, type, size, line, shared;
+        if (!readLine(dir + "level", &level) || !readLine(dir + "type", &type) ||
+            !readLine(dir + "size", &size)) {
+            break;
+        }
+        CacheLevel c;
+        c.level = std::atoi(level.c_str());
+        c.type = type;
+        c.sizeBytes = parseSize(size);
+        if (readLine(dir + "coherency_line_size", &line)) c.lineSize = std::atoi(line.c_str());
+        if (readLine(dir + "shared_cpu_list", &shared)) c.sharedCpus = shared;
+        c.source = "sysfs";
+        if (c.sizeBytes > 0) caches.push_back(c);
+    }
+    return caches;
+}
+
+inline std::vector<CacheLevel> fromCpuid() {
+    std::vector<CacheLevel> caches;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    unsigned leaf = 4;
+    __cpuid(0, eax, ebx, ecx, edx);
+    // ebx 为厂商字符串的前 4 个字节："Auth"enticAMD / "Hygo"nGenuine 使用扩展 leaf
+    if (ebx == 0x68747541 || ebx == 0x6f677948) {
+        leaf = 0x8000001D;
+    }
+    if (__get_cpuid_max(leaf & 0x80000000, nullptr) < leaf) return caches;
+    for (unsigned sub = 0; sub < 16; ++sub) {
+        __cpuid_count(leaf, sub, eax, ebx, ecx, edx);
+        unsigned kind = eax & 0x1f;
+        if (kind == 0) break;
+        CacheLevel c;
+        c.level = (eax >> 5) & 0x7;
+        c.type = kind == 1 ? "Data" : kind == 2 ? "Instruction" : "Unified";
+        size_t ways = ((ebx >> 22) & 0x3ff) + 1;
+        size_t partitions = ((ebx >> 12) & 0x3ff) + 1;
+        c.lineSize = (ebx & 0xfff) + 1;
+        size_t sets = (size_t)ecx + 1;
+        c.sizeBytes = ways * partitions * c.lineSize * sets;
+        c.source = "cpuid";
+        caches.push_back(c);
+    }
+#endif
+    return caches;
+}
+
+} // namespace cache_topology_details
+
+// 返回按层级排序的缓存列表（包含指令缓存）
+inline std::vector<CacheLevel> detectCaches() {
+    std::vector<CacheLevel> caches = cache_topology_details::fromSysfs();
+    if (caches.empty()) caches = cache_topology_details::fromCpuid();
+    std::stable_sort(caches.begin(), caches.end(),
+                     [](const CacheLevel& a, const CacheLevel& b) { return a.level < b.level; });
+    return caches;
+}
+
+// 只保留数据缓存与统一缓存，每个层级一项
+inline std::vector<CacheLevel> detectDataCaches() {
+    std::vector<CacheLevel> out;
+    for (const CacheLevel& c : detectCaches()) {
+        if (c.type == "Instruction") continue;
+        if (!out.empty() && out.back().level == c.level) continue;
+        out.push_back(c);
+    }
+    return out;
+}
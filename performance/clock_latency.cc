@@ -0,0 +1,210 @@
+// 系统调用、时钟与定时器的开销
+// hardware_latency.cc 每次测量都读 high_resolution_clock，client.cpp 每条消息读两次
+// get_current_time_us()（steady_clock），这里测量这些时间源本身的代价：
+//   clock_gettime（各 clock id，走 vDSO 或真正的系统调用）、rdtsc / rdtscp、std::chrono 各时钟、
+//   最简单的系统调用（getpid / syscall(SYS_getppid)）、sched_yield、futex 唤醒往返。
+// 最后按 “单调 + 分辨率不差于 1μs” 的要求给出最便宜的时间戳来源。
+//
+// 编译：g++ -O2 -std=c++17 -pthread clock_latency.cc -o clock_latency
+// 运行：./clock_latency [--tsc] [--perf] [--cpu=N] [--reps=N]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#if BENCH_HAS_TSC
+#include <cpuid.h>
+#endif
+
+using namespace std;
+
+// 候选时间戳来源
+struct Candidate {
+    string name;
+    double ns;
+    bool monotonic;
+    double resolutionNs;  // 0 表示未知
+};
+
+vector<Candidate> g_candidates;
+
+template <typename Fn>
+bench::Result measure(const string& name, Fn fn) {
+    auto r = bench::run(name, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) fn();
+    });
+    bench::printRow(r);
+    return r;
+}
+
+double clockResolutionNs(clockid_t id) {
+    timespec ts;
+    if (clock_getres(id, &ts) != 0) return 0;
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void measureClockGettime() {
+    bench::printHeader("clock_gettime");
+    struct Clock {
+        const char* name;
+        clockid_t id;
+        bool monotonic;
+    };
+    const Clock clocks[] = {
+        {"CLOCK_REALTIME", CLOCK_REALTIME, false},
+        {"CLOCK_REALTIME_COARSE", CLOCK_REALTIME_COARSE, false},
+        {"CLOCK_MONOTONIC", CLOCK_MONOTONIC, true},
+        {"CLOCK_MONOTONIC_COARSE", CLOCK_MONOTONIC_COARSE, true},
+        {"CLOCK_MONOTONIC_RAW", CLOCK_MONOTONIC_RAW, true},
+        {"CLOCK_BOOTTIME", CLOCK_BOOTTIME, true},
+        {"CLOCK_PROCESS_CPUTIME_ID", CLOCK_PROCESS_CPUTIME_ID, false},
+        {"CLOCK_THREAD_CPUTIME_ID", CLOCK_THREAD_CPUTIME_ID, false},
+    };
+    for (const Clock& c : clocks) {
+        timespec ts;
+        auto r = measure(c.name, [&] {
+            clock_gettime(c.id, &ts);
+            doNotOptimizeAway(ts);
+        });
+        g_candidates.push_back({c.name, r.median, c.monotonic, clockResolutionNs(c.id)});
+    }
+}
+
+// 检查 CPUID 0x80000007 EDX[8]：invariant TSC，频率恒定且各核同步时 rdtsc 才能当时钟用
+bool hasInvariantTsc() {
+#if BENCH_HAS_TSC
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+    __cpuid(0x80000007, eax, ebx, ecx, edx);
+    return (edx >> 8) & 1;
+#else
+    return false;
+#endif
+}
+
+void measureTsc() {
+#if BENCH_HAS_TSC
+    bench::printHeader("rdtsc / rdtscp");
+    bool invariant = hasInvariantTsc();
+    // 1 GHz 以上的 TSC 分辨率按 1ns 计
+    auto r = measure("rdtsc", [] { doNotOptimizeAway(__rdtsc()); });
+    g_candidates.push_back({"rdtsc", r.median, invariant, 1});
+    r = measure("rdtscp", [] {
+        unsigned aux;
+        doNotOptimizeAway(__rdtscp(&aux));
+    });
+    g_candidates.push_back({"rdtscp", r.median, invariant, 1});
+    measure("lfence + rdtsc + lfence", [] { doNotOptimizeAway(bench::tscBegin()); });
+    measure("rdtscp + lfence", [] { doNotOptimizeAway(bench::tscEnd()); });
+    if (!invariant) cout << "注意：CPU 未报告 invariant TSC，rdtsc 不宜直接作为时钟" << endl;
+#endif
+}
+
+// client.cpp 中的实现
+uint64_t get_current_time_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void measureChrono() {
+    bench::printHeader("std::chrono");
+    auto r = measure("steady_clock::now", [] { doNotOptimizeAway(chrono::steady_clock::now()); });
+    g_candidates.push_back({"std::chrono::steady_clock", r.median, true, 0});
+    r = measure("system_clock::now", [] { doNotOptimizeAway(chrono::system_clock::now()); });
+    g_candidates.push_back({"std::chrono::system_clock", r.median, false, 0});
+    r = measure("high_resolution_clock::now", [] {
+        doNotOptimizeAway(chrono::high_resolution_clock::now());
+    });
+    g_candidates.push_back({"std::chrono::high_resolution_clock", r.median,
+                            chrono::high_resolution_clock::is_steady, 0});
+    measure("get_current_time_us (client)", [] { doNotOptimizeAway(get_current_time_us()); });
+}
+
+void measureSyscalls() {
+    bench::printHeader("系统调用");
+    measure("getpid", [] { doNotOptimizeAway(getpid()); });
+    measure("syscall(SYS_getppid)", [] { doNotOptimizeAway(syscall(SYS_getppid)); });
+    measure("sched_yield", [] { doNotOptimizeAway(sched_yield()); });
+}
+
+long futex(atomic<int>* addr, int op, int val) {
+    return syscall(SYS_futex, reinterpret_cast<int*>(addr), op, val, nullptr, nullptr, 0);
+}
+
+// 两个线程通过 futex 互相唤醒，一次迭代为一次完整往返（两次 wake + 两次 wait）
+void measureFutexRoundTrip() {
+    bench::printHeader("futex 唤醒往返");
+    atomic<int> turn{0};  // 0：轮到 ping，1：轮到 pong
+    atomic<bool> quit{false};
+    thread pong([&] {
+        while (true) {
+            while (turn.load(memory_order_acquire) != 1) {
+                if (quit.load(memory_order_acquire)) return;
+                futex(&turn, FUTEX_WAIT_PRIVATE, 0);
+            }
+            turn.store(0, memory_order_release);
+            futex(&turn, FUTEX_WAKE_PRIVATE, 1);
+        }
+    });
+    measure("futex wake 往返", [&] {
+        turn.store(1, memory_order_release);
+        futex(&turn, FUTEX_WAKE_PRIVATE, 1);
+        while (turn.load(memory_order_acquire) != 0) {
+            futex(&turn, FUTEX_WAIT_PRIVATE, 1);
+        }
+    });
+    quit.store(true, memory_order_release);
+    turn.store(2, memory_order_release);
+    futex(&turn, FUTEX_WAKE_PRIVATE, 1);
+    pong.join();
+}
+
+void recommend() {
+    const Candidate* best = nullptr;
+    for (const Candidate& c : g_candidates) {
+        bool fineEnough = c.resolutionNs == 0 || c.resolutionNs <= 1000;
+        if (!c.monotonic || !fineEnough) continue;
+        if (!best || c.ns < best->ns) best = &c;
+    }
+    cout << "\n----- 建议 -----" << endl;
+    if (!best) {
+        cout << "没有找到满足 “单调 + 分辨率 <= 1μs” 的时间源" << endl;
+        return;
+    }
+    cout << "最便宜的单调、分辨率不差于 1μs 的时间源: " << best->name << "（" << fixed
+         << setprecision(3) << best->ns << " ns/次）" << endl;
+    if (best->name.rfind("rdtsc", 0) == 0) {
+        cout << "rdtsc 读数为周期数，需要像 bench.h 一样对照 steady_clock 标定频率后再换算成时间；"
+             << "可能要与其他进程的读数比较的时间戳（如 client 写进请求 id、由 server 原样回传的发送时刻）仍应使用 CLOCK_MONOTONIC" << endl;
+    }
+    for (const Candidate& c : g_candidates) {
+        if (c.name == "CLOCK_MONOTONIC_COARSE") {
+            cout << "CLOCK_MONOTONIC_COARSE 更便宜（" << c.ns << " ns/次），但分辨率只有 "
+                 << c.resolutionNs / 1e6 << " ms，只适合粗粒度超时判断" << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+    measureClockGettime();
+    measureTsc();
+    measureChrono();
+    measureSyscalls();
+    measureFutexRoundTrip();
+    recommend();
+    return 0;
+}
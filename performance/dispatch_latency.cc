@@ -0,0 +1,181 @@
+// 分发开销对比：虚函数、CRTP、函数指针、std::function、std::visit(std::variant)，
+// 以及 template/invoke.cc 中 invoke_expr / invoke_sfinae 两种包装方式。
+// 每种方式分别在三种调用点形态下测量：
+//   单态   - 调用点永远只看到一种实现（分支预测器完全命中）
+//   2 路   - 两种实现随机交替
+//   多态   - 8 种实现随机出现（megamorphic，间接分支大量预测失败）
+// 调用目标序列预先生成并循环使用，避免把随机数生成算进开销。
+//
+// 编译：g++ -O2 -std=c++17 dispatch_latency.cc -o dispatch_latency
+// 运行：./dispatch_latency [--tsc] [--perf] [--cpu=N] [--reps=N]
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "bench.h"
+
+using namespace std;
+
+constexpr int kMaxTargets = 8;
+constexpr size_t kSequenceLength = 1 << 16;  // 调用目标序列长度（2 的幂）
+
+// 每个实现做一点不同的运算，防止编译器把它们合并成同一个函数
+template <int K>
+inline int work(int x) {
+    return x * (2 * K + 1) + K;
+}
+
+// ---------- 虚函数 ----------
+struct Handler {
+    virtual ~Handler() = default;
+    virtual int handle(int x) = 0;
+};
+
+template <int K>
+struct HandlerImpl : Handler {
+    NOINLINE int handle(int x) override { return work<K>(x); }
+};
+
+// ---------- CRTP ----------
+// CRTP 只能在编译期确定类型，运行期选择目标仍需 switch，这里测量的正是这种“静态多态 + switch”的写法
+template <typename Derived>
+struct CrtpHandler {
+    int handle(int x) { return static_cast<Derived*>(this)->handleImpl(x); }
+};
+
+template <int K>
+struct CrtpImpl : CrtpHandler<CrtpImpl<K>> {
+    NOINLINE int handleImpl(int x) { return work<K>(x); }
+};
+
+// ---------- 函数指针 ----------
+template <int K>
+NOINLINE int freeHandler(int x) {
+    return work<K>(x);
+}
+
+// ---------- std::variant ----------
+template <int K>
+struct VariantAlt {
+    NOINLINE int operator()(int x) const { return work<K>(x); }
+};
+
+using HandlerVariant = variant<VariantAlt<0>, VariantAlt<1>, VariantAlt<2>, VariantAlt<3>,
+                               VariantAlt<4>, VariantAlt<5>, VariantAlt<6>, VariantAlt<7>>;
+
+// ---------- invoke.cc 中的两种包装（去掉了打印） ----------
+template <typename F> auto invoke_expr(F f) {
+    if constexpr (std::is_same_v<std::invoke_result_t<F>, void>) {
+        f();
+    } else {
+        auto ret = f();
+        return ret;
+    }
+}
+
+template <typename F,
+          std::enable_if_t<std::is_void_v<std::invoke_result_t<F>>, int> = 0>
+auto invoke_sfinae(F f) {
+    f();
+}
+template <typename F,
+          std::enable_if_t<!std::is_void_v<std::invoke_result_t<F>>, int> = 0>
+auto invoke_sfinae(F f) {
+    auto ret = f();
+    return ret;
+}
+
+template <size_t... Is>
+auto makeFunctionTable(index_sequence<Is...>) {
+    return array<int (*)(int), sizeof...(Is)>{&freeHandler<Is>...};
+}
+
+// 生成调用目标序列：targets 为 1 时全是 0，否则均匀随机
+vector<uint8_t> makeSequence(int targets) {
+    vector<uint8_t> seq(kSequenceLength);
+    mt19937 rng(42);
+    uniform_int_distribution<int> dist(0, targets - 1);
+    for (auto& s : seq) s = (uint8_t)dist(rng);
+    return seq;
+}
+
+struct Targets {
+    vector<unique_ptr<Handler>> virtuals;
+    array<int (*)(int), kMaxTargets> pointers = makeFunctionTable(make_index_sequence<kMaxTargets>{});
+    vector<function<int(int)>> functions;
+    vector<HandlerVariant> variants;
+
+    Targets() {
+        add(make_index_sequence<kMaxTargets>{});
+    }
+
+    template <size_t... Is>
+    void add(index_sequence<Is...>) {
+        (virtuals.push_back(make_unique<HandlerImpl<Is>>()), ...);
+        // 捕获一个指针，使 std::function 内部保存的是非空闭包
+        (functions.push_back([p = this](int x) { return freeHandler<Is>(x) + (p == nullptr); }), ...);
+        (variants.push_back(HandlerVariant(in_place_index<Is>)), ...);
+    }
+};
+
+// 在 seq 给出的目标序列上调用 call(target, x)，结果串成依赖链
+template <typename Call>
+bench::Result runDispatch(const string& name, const vector<uint8_t>& seq, Call call) {
+    int x = 1;
+    auto r = bench::run(name, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            x = call(seq[i & (kSequenceLength - 1)], x);
+            doNotOptimizeAway(x);
+        }
+    });
+    bench::printRow(r);
+    return r;
+}
+
+// CRTP 需要在运行期通过 switch 选择具体类型
+template <typename Tuple, size_t... Is>
+int crtpSwitch(Tuple& impls, int target, int x, index_sequence<Is...>) {
+    int ret = 0;
+    ((target == (int)Is ? (ret = std::get<Is>(impls).handle(x), true) : false) || ...);
+    return ret;
+}
+
+void measureShape(const string& shape, int targets, Targets& t) {
+    bench::printHeader("分发开销：" + shape);
+    vector<uint8_t> seq = makeSequence(targets);
+    tuple<CrtpImpl<0>, CrtpImpl<1>, CrtpImpl<2>, CrtpImpl<3>,
+          CrtpImpl<4>, CrtpImpl<5>, CrtpImpl<6>, CrtpImpl<7>> crtp;
+
+    runDispatch("直接调用（基准）", seq, [](int, int x) { return freeHandler<0>(x); });
+    runDispatch("虚函数", seq, [&](int k, int x) { return t.virtuals[k]->handle(x); });
+    runDispatch("CRTP + switch", seq, [&](int k, int x) {
+        return crtpSwitch(crtp, k, x, make_index_sequence<kMaxTargets>{});
+    });
+    runDispatch("函数指针", seq, [&](int k, int x) { return t.pointers[k](x); });
+    runDispatch("std::function", seq, [&](int k, int x) { return t.functions[k](x); });
+    runDispatch("std::visit(variant)", seq, [&](int k, int x) {
+        return std::visit([x](auto const& h) { return h(x); }, t.variants[k]);
+    });
+    runDispatch("invoke_expr(虚函数)", seq, [&](int k, int x) {
+        return invoke_expr([&] { return t.virtuals[k]->handle(x); });
+    });
+    runDispatch("invoke_sfinae(虚函数)", seq, [&](int k, int x) {
+        return invoke_sfinae([&] { return t.virtuals[k]->handle(x); });
+    });
+}
+
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+    Targets t;
+    measureShape("单态调用点", 1, t);
+    measureShape("2 路随机", 2, t);
+    measureShape("8 路随机（megamorphic）", kMaxTargets, t);
+    return 0;
+}
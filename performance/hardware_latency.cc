@@ -3,42 +3,33 @@
 #include <vector>
 #include <string>
 #include <iomanip>
+#include <cmath>
+#include <sstream>
 
-using namespace std;
-using namespace std::chrono;
+#include "bench.h"
+#include "cache_topology.h"
+#include "pointer_chase.h"
 
-// 防止优化掉计算结果
-// 编译器屏障，告诉编译器“这里的 value 被使用了”，从而防止那些看起来没有副作用的计算被优化掉
-// 并不会真正把数据写入内存，也不会显著影响测量延迟，而是确保你测量的那段代码不会被编译器剔除或重排序。
-template <typename T>
-inline void doNotOptimizeAway(T const& value) {
-    asm volatile("" : : "r,m"(value) : "memory");
-}
+// 编译：g++ -O2 -std=c++17 hardware_latency.cc -o hardware_latency
+// 运行：./hardware_latency [--tsc] [--perf] [--cpu=N] [--reps=N] [--target_ms=X] [--json=PATH]
 
-// 定义防止内联的宏
-#if defined(_MSC_VER)
-#define NOINLINE __declspec(noinline)
-#else
-#define NOINLINE __attribute__((noinline))
-#endif
+using namespace std;
+using namespace std::chrono;
 
 volatile int global_dummy = 0; // 用于防止编译器优化
 
 // 测量单次加法操作的延迟（纳秒级）
 void measureAdditionLatency() {
     volatile int a = 1, b = 2, c = 0;
-    const int iterations = 100000000; // 1e8 次迭代
-    auto start = high_resolution_clock::now();
-    for (int i = 0; i < iterations; ++i) {
-        c = a + b;
-        doNotOptimizeAway(c);
-    }
-    auto end = high_resolution_clock::now();
+    auto r = bench::run("加法操作", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            c = a + b;
+            doNotOptimizeAway(c);
+        }
+    });
     // 将结果写入全局变量防止完全被优化掉
     global_dummy = c;
-    auto duration = duration_cast<nanoseconds>(end - start).count();
-    cout << "加法操作延迟: " << fixed << setprecision(3)
-         << (double)duration / iterations << " ns/次" << endl;
+    bench::printRow(r);
 }
 
 // 普通函数（非虚函数）调用测试
@@ -49,18 +40,15 @@ NOINLINE int normalFunc(int x) {
 }
 
 void measureNormalFuncLatency() {
-    const int iterations = 100000000;
     volatile int sum = 0;
-    auto start = high_resolution_clock::now();
-    for (int i = 0; i < iterations; ++i) {
-        sum = normalFunc(sum);
-        doNotOptimizeAway(sum);
-    }
-    auto end = high_resolution_clock::now();
+    auto r = bench::run("普通函数调用", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            sum = normalFunc(sum);
+            doNotOptimizeAway(sum);
+        }
+    });
     global_dummy = sum;
-    auto duration = duration_cast<nanoseconds>(end - start).count();
-    cout << "普通函数调用延迟: " << fixed << setprecision(3)
-         << (double)duration / iterations << " ns/次" << endl;
+    bench::printRow(r);
 }
 
 // 虚函数调用测试：定义基类与派生类，利用虚函数调用产生间接寻址开销
@@ -83,37 +71,32 @@ public:
 };
 
 void measureVirtualFuncLatency() {
-    const int iterations = 100000000;
     volatile int sum = 0;
     Derived d;
     Base* ptr = &d;
-    auto start = high_resolution_clock::now();
-    for (int i = 0; i < iterations; ++i) {
-        sum = ptr->virtualFunc(sum);
-        doNotOptimizeAway(sum);
-    }
-    auto end = high_resolution_clock::now();
+    auto r = bench::run("虚函数调用", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            sum = ptr->virtualFunc(sum);
+            doNotOptimizeAway(sum);
+        }
+    });
     global_dummy = sum;
-    auto duration = duration_cast<nanoseconds>(end - start).count();
-    cout << "虚函数调用延迟: " << fixed << setprecision(3)
-         << (double)duration / iterations << " ns/次" << endl;
+    bench::printRow(r);
 }
 
 // 寄存器操作延迟测试（其实与简单加法类似，寄存器操作速度极快）
 void measureRegisterLatency() {
-    const size_t iterations = 1000000000;
-    register int a = 1, b = 2, c = 0;
-    auto start = high_resolution_clock::now();
-    for (size_t i = 0; i < iterations; ++i) {
-        c = a + b;
-        doNotOptimizeAway(c);
-        a = c;
-    }
-    auto end = high_resolution_clock::now();
+    int c = 0;
+    auto r = bench::run("寄存器操作", [&](uint64_t iterations) {
+        int a = 1, b = 2;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            c = a + b;
+            doNotOptimizeAway(c);
+            a = c;
+        }
+    });
     global_dummy = c;
-    auto duration = duration_cast<nanoseconds>(end - start).count();
-    cout << "寄存器操作延迟: " << fixed << setprecision(3)
-         << (double)duration / iterations << " ns/次" << endl;
+    bench::printRow(r);
 }
 
 // 利用指针跳跃法测量不同内存层级的访问延迟
@@ -121,112 +104,152 @@ void measureRegisterLatency() {
 //   numElements - 数组中元素个数
 //   stride      - 跳跃步长（单位：元素数）
 //   levelName   - 内存层级名称（如 "L1 Cache"）
-//   iterations  - 循环次数
-void measureCacheLatency(size_t numElements, size_t stride, const string& levelName, int iterations) {
-    vector<size_t> array(numElements);
-    // 构建循环链表，避免预取优化
-    for (size_t i = 0; i < numElements; ++i) {
-        array[i] = (i + stride) % numElements;
-    }
+bench::Result measureCacheLatency(size_t numElements, size_t stride, const string& levelName,
+                                  const bench::Options& opt = bench::config().defaults) {
+    vector<size_t> array = buildChain(numElements, stride);
     size_t index = 0;
-    auto start = high_resolution_clock::now();
-    for (int i = 0; i < iterations; ++i) {
-        index = array[index];
-        doNotOptimizeAway(index);
+    auto r = bench::run(levelName, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            index = array[index];
+            doNotOptimizeAway(index);
+        }
+    }, opt);
+    bench::printRow(r);
+    return r;
+}
+
+struct SweepPoint {
+    size_t bytes;
+    double latency;
+};
+
+// 一个延迟平台：数组大小在 [firstBytes, lastBytes] 内延迟基本不变
+struct Plateau {
+    size_t firstBytes;
+    size_t lastBytes;
+    double latency;
+};
+
+// 在对数坐标下寻找延迟平台：
+//   1. 先做 3 点中位数滤波，去掉偶发的噪声尖峰；
+//   2. 相邻两点延迟比超过 jumpRatio，或相对平台起点累计涨幅超过 driftRatio，视为进入过渡区；
+//   3. 连续不少于 minPoints 个非过渡点构成一个平台，平台的最后一个点即推断出的该层容量；
+//   4. 与上一个平台延迟相差不到 jumpRatio 的平台（TLB 等因素造成的缓慢爬升）合并到上一个平台。
+vector<Plateau> detectPlateaus(const vector<SweepPoint>& raw, double jumpRatio = 1.25,
+                               double driftRatio = 1.5, size_t minPoints = 3) {
+    vector<SweepPoint> points = raw;
+    for (size_t i = 1; i + 1 < raw.size(); ++i) {
+        points[i].latency = bench::medianOf({raw[i - 1].latency, raw[i].latency, raw[i + 1].latency});
+    }
+    vector<Plateau> plateaus;
+    size_t start = 0;
+    auto flush = [&](size_t end) {  // [start, end]
+        if (end + 1 - start < minPoints) return;
+        vector<double> lat;
+        for (size_t i = start; i <= end; ++i) lat.push_back(points[i].latency);
+        Plateau p{points[start].bytes, points[end].bytes, bench::medianOf(lat)};
+        if (!plateaus.empty() && p.latency < plateaus.back().latency * jumpRatio) {
+            plateaus.back().lastBytes = p.lastBytes;
+            return;
+        }
+        plateaus.push_back(p);
+    };
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (points[i].latency > points[i - 1].latency * jumpRatio ||
+            points[i].latency > points[start].latency * driftRatio) {
+            flush(i - 1);
+            start = i;
+        }
     }
-    auto end = high_resolution_clock::now();
-    auto duration = duration_cast<nanoseconds>(end - start).count();
-    cout << levelName << " 访问延迟: " << fixed << setprecision(3)
-         << (double)duration / iterations << " ns/次" << endl;
+    flush(points.size() - 1);
+    return plateaus;
+}
+
+string formatBytes(size_t bytes) {
+    ostringstream os;
+    double kb = bytes / 1024.0;
+    double mb = kb / 1024.0;
+    if (mb >= 1) {
+        os << fixed << setprecision(bytes % (1 << 20) ? 1 : 0) << mb << " MB";
+    } else {
+        os << fixed << setprecision(bytes % 1024 ? 1 : 0) << kb << " KB";
+    }
+    return os.str();
 }
 
 // 通过改变数组大小来估算缓存大小：当数组大小超过某一级缓存时，访问延迟会明显增大
-void estimateCacheSize() {
-    cout << "\n估算缓存大小（数组大小 vs 访问延迟）:" << endl;
-    // 数组大小从 1KB 到 128MB，每次翻倍
-    for (size_t size = 1024; size <= 128 * 1024 * 1024; size *= 2) {
-        size_t numElements = size / sizeof(size_t);
-        vector<size_t> array(numElements);
-        size_t stride = 16; // 大致 16 * sizeof(size_t) 字节
-        // 构建循环链表
-        for (size_t i = 0; i < numElements; ++i) {
-            array[i] = (i + stride) % numElements;
-        }
-        const int iterations = 100000000;
+// 大小按 2^(1/4) 的比例递增（非 2 的幂），再用 detectPlateaus 自动识别各层平台与过渡点
+void estimateCacheSize(const vector<CacheLevel>& caches) {
+    bench::printHeader("估算缓存大小（数组大小 vs 访问延迟）");
+    bench::Options opt = bench::config().defaults;
+    opt.repetitions = std::min(opt.repetitions, 5);
+    opt.targetMs = std::min(opt.targetMs, 10.0);
+
+    size_t maxBytes = 128 * 1024 * 1024;
+    if (!caches.empty()) maxBytes = std::max(maxBytes, caches.back().sizeBytes * 4);
+    vector<SweepPoint> points;
+    for (double size = 4 * 1024; size <= maxBytes; size *= std::pow(2.0, 0.25)) {
+        size_t bytes = (size_t)size / 64 * 64;
+        vector<size_t> array = buildRandomChain(bytes);
         size_t index = 0;
-        auto start = high_resolution_clock::now();
-        for (int i = 0; i < iterations; ++i) {
-            index = array[index];
-            doNotOptimizeAway(index);
-        }
-        auto end = high_resolution_clock::now();
-        auto duration = duration_cast<nanoseconds>(end - start).count();
-        double avgLatency = (double)duration / iterations;
-        cout << "数组大小 " << size / 1024 << " KB: " << fixed << setprecision(3)
-             << avgLatency << " ns/次" << endl;
+        auto r = bench::run("数组大小 " + formatBytes(bytes), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                index = array[index];
+                doNotOptimizeAway(index);
+            }
+        }, opt);
+        bench::printRow(r);
+        points.push_back({bytes, r.median});
+    }
+
+    vector<Plateau> plateaus = detectPlateaus(points);
+    cout << "\n推断的缓存层级（延迟平台）:" << endl;
+    for (size_t i = 0; i < plateaus.size(); ++i) {
+        const Plateau& p = plateaus[i];
+        bool last = i + 1 == plateaus.size();
+        string name = last && plateaus.size() > caches.size() ? "内存" : "L" + to_string(i + 1);
+        cout << name << ": 延迟 " << fixed << setprecision(3) << p.latency << " ns, 平台范围 "
+             << formatBytes(p.firstBytes) << " ~ " << formatBytes(p.lastBytes);
+        if (!last) cout << "，推断容量约 " << formatBytes(p.lastBytes);
+        if (i < caches.size()) cout << "（系统报告 " << formatBytes(caches[i].sizeBytes) << "）";
+        cout << endl;
     }
 }
 
-int main() {
-    cout << "----- 性能测量 -----" << endl;
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+
+    bench::printHeader("性能测量");
     measureAdditionLatency();
     measureNormalFuncLatency();
     measureVirtualFuncLatency();
     measureRegisterLatency();
 
-    cout << "\n----- 缓存访问延迟测量 -----" << endl;
-    // 这里假设 size_t 大小为 8 字节，根据实际情况也可以选择 int（4 字节）
-    // 设定各层缓存对应的数组大小（单位：元素数）：
-    // L1: 256KB, L2: 8MB, L3: 35MB, 主存: 1GB
-    int pointerChaseIterations = 10000000;
-    size_t l1_size = 256 * 1024 / sizeof(size_t);     // 256KB
-    size_t l2_size = 8 * 1024 * 1024 / sizeof(size_t);  // 8MB
-    size_t l3_size = 35 * 1024 * 1024 / sizeof(size_t); // 35MB
-    size_t mem_size = 1024 * 1024 * 1024 / sizeof(size_t); // 1GB
+    bench::printHeader("缓存访问延迟测量");
+    // 各层数组大小取该层容量的一半，保证数据完全落在该层；主存取最后一级缓存的 4 倍（至少 256MB）
+    // 读取不到缓存信息时回退到原来的假设：L1: 256KB, L2: 8MB, L3: 35MB
+    vector<CacheLevel> caches = detectDataCaches();
+    if (caches.empty()) {
+        cout << "未能读取缓存拓扑，使用默认假设" << endl;
+        caches = {{1, "Data", 256 * 1024, 64, "", "default"},
+                  {2, "Unified", 8 * 1024 * 1024, 64, "", "default"},
+                  {3, "Unified", 35 * 1024 * 1024, 64, "", "default"}};
+    }
+    for (const CacheLevel& c : caches) {
+        cout << "L" << c.level << " " << c.type << ": " << formatBytes(c.sizeBytes)
+             << ", line " << c.lineSize << " B";
+        if (!c.sharedCpus.empty()) cout << ", shared by cpu " << c.sharedCpus;
+        cout << " (" << c.source << ")" << endl;
+    }
     size_t stride = 16; // 跳跃步长
+    for (const CacheLevel& c : caches) {
+        measureCacheLatency(c.sizeBytes / 2 / sizeof(size_t), stride,
+                            "L" + to_string(c.level) + " Cache (" + formatBytes(c.sizeBytes / 2) + ")");
+    }
+    size_t memBytes = std::max<size_t>(caches.back().sizeBytes * 4, 256 * 1024 * 1024);
+    measureCacheLatency(memBytes / sizeof(size_t), stride, "内存 (" + formatBytes(memBytes) + ")");
 
-    measureCacheLatency(l1_size, stride, "L1 Cache", pointerChaseIterations);
-    measureCacheLatency(l2_size, stride, "L2 Cache", pointerChaseIterations);
-    measureCacheLatency(l3_size, stride, "L3 Cache", pointerChaseIterations);
-    measureCacheLatency(mem_size, stride, "内存", pointerChaseIterations);
-
-    estimateCacheSize();
+    estimateCacheSize(caches);
 
     return 0;
 }
-
-
-
-/*
------ 性能测量 -----
-加法操作延迟: 0.631 ns/次
-普通函数调用延迟: 1.337 ns/次
-虚函数调用延迟: 1.646 ns/次
-寄存器操作延迟: 0.315 ns/次
-
------ 缓存访问延迟测量 -----
-L1 Cache 访问延迟: 3.874 ns/次
-L2 Cache 访问延迟: 7.290 ns/次
-L3 Cache 访问延迟: 15.636 ns/次
-内存 访问延迟: 24.584 ns/次
-
-估算缓存大小（数组大小 vs 访问延迟）:
-数组大小 1 KB: 1.577 ns/次
-数组大小 2 KB: 1.577 ns/次
-数组大小 4 KB: 1.576 ns/次
-数组大小 8 KB: 1.576 ns/次
-数组大小 16 KB: 1.577 ns/次
-数组大小 32 KB: 1.578 ns/次
-数组大小 64 KB: 3.953 ns/次
-数组大小 128 KB: 3.953 ns/次
-数组大小 256 KB: 3.890 ns/次
-数组大小 512 KB: 3.988 ns/次
-数组大小 1024 KB: 5.960 ns/次
-数组大小 2048 KB: 7.661 ns/次
-数组大小 4096 KB: 7.670 ns/次
-数组大小 8192 KB: 8.303 ns/次
-数组大小 16384 KB: 7.446 ns/次
-数组大小 32768 KB: 12.339 ns/次
-数组大小 65536 KB: 21.063 ns/次
-数组大小 131072 KB: 23.958 ns/次
-*/
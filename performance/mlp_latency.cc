@@ -0,0 +1,144 @@
+// 访存级并行（memory-level parallelism）与分支预测失败的微基准
+//
+// 1. 多链指针跳跃：在远大于最后一级缓存的数组上同时推进 K 条互不依赖的随机链（K = 1..16）。
+//    单条链时每次访问都要等上一次缺失返回；多条链时乱序核可以让多个缺失同时在途。
+//    有效并发缺失数（MLP）≈ 单链每次访问耗时 / K 链时平均每次访问耗时。
+// 2. 分支可预测性：对同一组数据做 “v >= 128 则累加”，数据分别为有序、随机，
+//    以及按给定概率把规律模式（32 个一组交替）替换为随机值，再与无分支写法对比。
+//
+// 编译：g++ -O2 -std=c++17 mlp_latency.cc -o mlp_latency
+// 运行：./mlp_latency [--mb=N] [--tsc] [--perf] [--cpu=N] [--reps=N]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "cache_topology.h"
+#include "pointer_chase.h"
+#include "../template/unroll.h"
+
+using namespace std;
+
+struct ChainResult {
+    int chains;
+    double nsPerAccess;
+};
+
+// 同时推进 K 条链，每次迭代每条链各前进一步；static_for 保证 K 次加载完全展开、互不依赖
+template <size_t K>
+ChainResult measureChains(const vector<size_t>& array) {
+    vector<size_t> starts = chainStarts(array, K);
+    size_t idx[K];
+    for (size_t j = 0; j < K; ++j) idx[j] = starts[j];
+    auto r = bench::run(to_string(K) + " 条链", [&](uint64_t iterations) {
+        size_t local[K];
+        for (size_t j = 0; j < K; ++j) local[j] = idx[j];
+        for (uint64_t i = 0; i < iterations; ++i) {
+            static_for<K>([&](auto j) { local[j] = array[local[j]]; });
+        }
+        for (size_t j = 0; j < K; ++j) {
+            idx[j] = local[j];
+            doNotOptimizeAway(idx[j]);
+        }
+    });
+    bench::printRow(r);
+    return {K, r.median / K};
+}
+
+void measureMemoryParallelism(size_t bytes) {
+    bench::printHeader("访存级并行：K 条独立链（数组 " + to_string(bytes >> 20) + " MB，ns/次为每轮 K 次访问）");
+    vector<size_t> array = buildRandomChain(bytes);
+    vector<ChainResult> results = {
+        measureChains<1>(array),  measureChains<2>(array),  measureChains<3>(array),
+        measureChains<4>(array),  measureChains<6>(array),  measureChains<8>(array),
+        measureChains<10>(array), measureChains<12>(array), measureChains<16>(array),
+    };
+    double single = results.front().nsPerAccess;
+    cout << "\n" << setw(8) << "chains" << setw(16) << "ns/access" << setw(12) << "MLP" << endl;
+    for (const ChainResult& c : results) {
+        cout << setw(8) << c.chains << fixed << setprecision(3) << setw(16) << c.nsPerAccess
+             << setw(12) << single / c.nsPerAccess << endl;
+    }
+}
+
+constexpr size_t kBranchData = 1 << 16;
+
+// 以概率 randomRatio 把规律模式替换为随机值；模式为 32 个 >= 128、32 个 < 128 交替
+vector<uint8_t> makeBranchData(double randomRatio) {
+    vector<uint8_t> data(kBranchData);
+    mt19937 rng(7);
+    uniform_real_distribution<double> coin(0, 1);
+    uniform_int_distribution<int> byte(0, 255);
+    for (size_t i = 0; i < kBranchData; ++i) {
+        int v = (i / 32) % 2 ? 200 : 50;
+        data[i] = (uint8_t)(coin(rng) < randomRatio ? byte(rng) : v);
+    }
+    return data;
+}
+
+void measureBranch(const string& name, const vector<uint8_t>& data) {
+    uint64_t sum = 0;
+    auto r = bench::run(name, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint8_t v = data[i & (kBranchData - 1)];
+            if (v >= 128) {
+                sum += v;
+                // 分支内对 sum 的寄存器屏障阻止 GCC/Clang 把分支转换为 cmov；
+                // 不用 "memory" 屏障，否则 sum 在被执行的一侧每次都要写回、重新读入内存
+                asm volatile("" : "+r"(sum));
+            }
+        }
+        doNotOptimizeAway(sum);
+    });
+    bench::printRow(r);
+}
+
+void measureBranchless(const string& name, const vector<uint8_t>& data) {
+    uint64_t sum = 0;
+    auto r = bench::run(name, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint8_t v = data[i & (kBranchData - 1)];
+            // v >= 128 时掩码为全 1，否则为 0
+            sum += v & (0 - (uint64_t)(v >> 7));
+        }
+        doNotOptimizeAway(sum);
+    });
+    bench::printRow(r);
+}
+
+void measureBranchPredictability() {
+    bench::printHeader("分支可预测性（ns/次为每个元素）");
+    vector<uint8_t> random = makeBranchData(1.0);
+    vector<uint8_t> sorted = random;
+    std::sort(sorted.begin(), sorted.end());
+    measureBranch("有序数据", sorted);
+    measureBranch("随机数据", random);
+    for (double p : {0.0, 0.01, 0.05, 0.1, 0.25, 0.5}) {
+        ostringstream name;
+        name << "规律模式 + " << p * 100 << "% 随机";
+        measureBranch(name.str(), makeBranchData(p));
+    }
+    measureBranchless("无分支写法（随机数据）", random);
+}
+
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+    // 工作集默认取最后一级缓存的 4 倍（至少 256MB），可用 --mb=N 覆盖
+    vector<CacheLevel> caches = detectDataCaches();
+    size_t bytes = 256 << 20;
+    if (!caches.empty()) bytes = std::max(bytes, caches.back().sizeBytes * 4);
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--mb=", 5) == 0) bytes = (size_t)std::atol(argv[i] + 5) << 20;
+    }
+    measureMemoryParallelism(bytes);
+    measureBranchPredictability();
+    return 0;
+}
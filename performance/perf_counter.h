@@ -0,0 +1,290 @@
+#pragma once
+// 基于 perf_event_open 的硬件性能计数器
+// 统计 cycles、instructions、L1D/LLC 读缺失、dTLB 读缺失、分支预测失败次数。
+// 每个事件单独打开（不组成 group），计数器不足时由内核轮转复用，读数按
+// time_enabled / time_running 缩放。只统计用户态（exclude_kernel），
+// 在 perf_event_paranoid <= 2 的机器上无需 root。
+//
+// 用法一：直接计数
+//   perf::CounterGroup g;
+//   g.start(); work(); perf::Counts c = g.stop();
+//
+// 用法二：RAII，把当前线程的计数累加到一个全局累加器（适合 brpc 回调跑在多个 worker 上的场景）
+//   static perf::Accumulator acc;
+//   { perf::Scope s(acc); handle(); }
+//   acc.print(std::cout, acc.calls());
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+enum Event {
+    kCycles,
+    kInstructions,
+    kL1dMiss,
+    kLlcMiss,
+    kDtlbMiss,
+    kBranchMiss,
+    kNumEvents
+};
+
+inline const char* eventName(int e) {
+    static const char* const names[kNumEvents] = {
+        "cycles", "instructions", "L1D-miss", "LLC-miss", "dTLB-miss", "branch-miss"};
+    return names[e];
+}
+
+struct Counts {
+    double value[kNumEvents] = {};
+    bool valid[kNumEvents] = {};
+
+    Counts& operator+=(const Counts& o) {
+        for (int i = 0; i < kNumEvents; ++i) {
+            value[i] += o.value[i];
+            valid[i] = valid[i] || o.valid[i];
+        }
+        return *this;
+    }
+
+    // 打印每 n 次操作的平均计数，n 为 0 时打印总数
+    void print(std::ostream& os, double n = 0) const {
+        auto oldflags = os.flags();
+        auto oldprec = os.precision();
+        os << std::fixed << std::setprecision(3);
+        for (int i = 0; i < kNumEvents; ++i) {
+            if (!valid[i]) continue;
+            os << "  " << eventName(i) << "=" << (n > 0 ? value[i] / n : value[i]);
+        }
+        if (valid[kCycles] && valid[kInstructions] && value[kCycles] > 0) {
+            os << "  IPC=" << value[kInstructions] / value[kCycles];
+        }
+        os.flags(oldflags);
+        os.precision(oldprec);
+    }
+};
+
+class CounterGroup {
+public:
+    CounterGroup() {
+        for (int i = 0; i < kNumEvents; ++i) fds_[i] = open(i);
+    }
+
+    ~CounterGroup() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    // 至少有一个事件可用
+    bool ok() const {
+        for (int fd : fds_) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    struct Reading {
+        uint64_t value = 0;
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+    };
+
+    // 所有事件的一次读数；计数区间 = 两次读数之差
+    struct Snapshot {
+        Reading r[kNumEvents];
+        bool ok[kNumEvents] = {};
+    };
+
+    // 可以嵌套：计数器只在最外层 begin 时打开、最外层 end 时关闭，
+    // 每层用自己的 Snapshot 求差，内层结束不会影响外层
+    Snapshot begin() {
+        if (depth_++ == 0) enable(true);
+        return snapshot();
+    }
+
+    Counts end(const Snapshot& base) {
+        Counts c = since(base);
+        if (--depth_ == 0) enable(false);
+        return c;
+    }
+
+    void start() { base_ = begin(); }
+    Counts stop() { return end(base_); }
+
+private:
+    void enable(bool on) {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) ioctl(fd, on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+        }
+#else
+        (void)on;
+#endif
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        for (int i = 0; i < kNumEvents; ++i) {
+            s.ok[i] = fds_[i] >= 0 && read(i, &s.r[i]);
+        }
+        return s;
+    }
+
+    Counts since(const Snapshot& base) const {
+        Counts c;
+        Snapshot now = snapshot();
+        for (int i = 0; i < kNumEvents; ++i) {
+            if (!base.ok[i] || !now.ok[i]) continue;
+            uint64_t running = now.r[i].running - base.r[i].running;
+            uint64_t enabled = now.r[i].enabled - base.r[i].enabled;
+            if (running == 0) continue;
+            c.value[i] = (double)(now.r[i].value - base.r[i].value) * enabled / running;
+            c.valid[i] = true;
+        }
+        return c;
+    }
+
+    static int open(int e) {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        auto cache = [](uint64_t id) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (e) {
+        case kCycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case kInstructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case kL1dMiss:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case kLlcMiss:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case kDtlbMiss:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        case kBranchMiss:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            return -1;
+        }
+        // pid = 0, cpu = -1：统计调用线程，不限 CPU
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        (void)e;
+        return -1;
+#endif
+    }
+
+    bool read(int i, Reading* r) const {
+#if defined(__linux__)
+        uint64_t buf[3];
+        if (::read(fds_[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) return false;
+        r->value = buf[0];
+        r->enabled = buf[1];
+        r->running = buf[2];
+        return true;
+#else
+        (void)i;
+        (void)r;
+        return false;
+#endif
+    }
+
+    int fds_[kNumEvents];
+    Snapshot base_;
+    int depth_ = 0;
+};
+
+// 线程安全的计数累加器，多个线程上的 Scope 可以汇总到同一个实例
+class Accumulator {
+public:
+    void add(const Counts& c) {
+        for (int i = 0; i < kNumEvents; ++i) {
+            if (!c.valid[i]) continue;
+            sum_[i].fetch_add((uint64_t)c.value[i], std::memory_order_relaxed);
+            valid_[i].store(true, std::memory_order_relaxed);
+        }
+        calls_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Counts total() const {
+        Counts c;
+        for (int i = 0; i < kNumEvents; ++i) {
+            c.value[i] = (double)sum_[i].load(std::memory_order_relaxed);
+            c.valid[i] = valid_[i].load(std::memory_order_relaxed);
+        }
+        return c;
+    }
+
+    uint64_t calls() const { return calls_.load(std::memory_order_relaxed); }
+
+    void print(std::ostream& os, double n = 0) const { total().print(os, n); }
+
+private:
+    std::atomic<uint64_t> sum_[kNumEvents] = {};
+    std::atomic<bool> valid_[kNumEvents] = {};
+    std::atomic<uint64_t> calls_{0};
+};
+
+// 每个线程一份计数器，避免每次进入 Scope 都调用 perf_event_open
+inline CounterGroup& threadCounters() {
+    thread_local CounterGroup g;
+    return g;
+}
+
+// RAII：构造时开始计数，析构时把当前线程的增量累加到 acc。
+// 同一线程上的 Scope 共用一组计数器，可以嵌套（内层的计数也计入外层）
+class Scope {
+public:
+    explicit Scope(Accumulator& acc, bool enabled = true)
+        : acc_(acc), enabled_(enabled && threadCounters().ok()) {
+        if (enabled_) base_ = threadCounters().begin();
+    }
+
+    ~Scope() {
+        if (enabled_) acc_.add(threadCounters().end(base_));
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Accumulator& acc_;
+    bool enabled_;
+    CounterGroup::Snapshot base_;
+};
+
+} // namespace perf
@@ -0,0 +1,52 @@
+#pragma once
+// 指针跳跃（pointer chasing）用的循环链表
+// array[i] 中保存下一个要访问的下标，每次访问都依赖上一次的结果，从而测出真实的访问延迟。
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// 构建步长为 stride 的循环链表，避免预取优化
+inline std::vector<size_t> buildChain(size_t numElements, size_t stride) {
+    std::vector<size_t> array(numElements);
+    for (size_t i = 0; i < numElements; ++i) {
+        array[i] = (i + stride) % numElements;
+    }
+    return array;
+}
+
+// 构建随机顺序的循环链表：每个缓存行只放一个节点，访问顺序随机，使硬件预取失效
+inline std::vector<size_t> buildRandomChain(size_t bytes, size_t lineSize = 64) {
+    size_t perLine = lineSize / sizeof(size_t);
+    size_t lines = std::max<size_t>(bytes / lineSize, 2);
+    std::vector<size_t> order(lines);
+    for (size_t i = 0; i < lines; ++i) order[i] = i;
+    // Sattolo 算法：生成只有一个环的随机排列
+    std::mt19937_64 rng(12345);
+    for (size_t i = lines - 1; i > 0; --i) {
+        std::uniform_int_distribution<size_t> dist(0, i - 1);
+        std::swap(order[i], order[dist(rng)]);
+    }
+    std::vector<size_t> array(lines * perLine);
+    for (size_t i = 0; i < lines; ++i) {
+        array[order[i] * perLine] = order[(i + 1) % lines] * perLine;
+    }
+    return array;
+}
+
+// 沿链表把环等分为 k 段，返回每段的起点；从这些起点同时出发的 k 条链互不重叠、互不依赖
+inline std::vector<size_t> chainStarts(const std::vector<size_t>& array, size_t k, size_t start = 0) {
+    size_t length = 0;
+    size_t index = start;
+    do {
+        index = array[index];
+        ++length;
+    } while (index != start);
+    std::vector<size_t> starts;
+    index = start;
+    for (size_t i = 0; i < length; ++i) {
+        if (starts.size() < k && i == starts.size() * length / k) starts.push_back(index);
+        index = array[index];
+    }
+    return starts;
+}
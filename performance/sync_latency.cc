@@ -0,0 +1,300 @@
+// 原子操作与同步原语的开销
+// 覆盖：不同内存序的 std::atomic fetch_add、CAS 循环、std::mutex / 自旋锁 / futex 锁、
+// std::shared_mutex（读锁与写锁）、thread_local 访问，以及 client.cpp 中
+// g_sent_count / g_recv_count 的用法（一个线程发送计数、另一个线程接收计数）。
+// 每组用例在 1..N 个线程下运行：所有线程同时执行 iterations 次操作，
+// 表中 ns/次 = 总耗时 / iterations，即每个线程看到的单次操作耗时。
+//
+// 编译：g++ -O2 -std=c++17 -pthread sync_latency.cc -o sync_latency
+// 运行：./sync_latency [--threads=N] [--tsc] [--perf] [--reps=N]
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench.h"
+
+using namespace std;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+// 常驻线程组：避免把线程创建的开销算进测量。
+// run(iterations) 唤醒其余线程，与调用线程一起执行 job(tid, iterations)，全部完成后返回。
+class ThreadTeam {
+public:
+    explicit ThreadTeam(int threads) : threads_(threads) {
+        for (int tid = 1; tid < threads; ++tid) {
+            workers_.emplace_back([this, tid] { loop(tid); });
+        }
+    }
+
+    ~ThreadTeam() {
+        quit_.store(true, memory_order_release);
+        generation_.fetch_add(1, memory_order_release);
+        for (auto& t : workers_) t.join();
+    }
+
+    void setJob(function<void(int, uint64_t)> job) { job_ = std::move(job); }
+
+    void run(uint64_t iterations) {
+        iterations_ = iterations;
+        done_.store(0, memory_order_relaxed);
+        generation_.fetch_add(1, memory_order_release);
+        job_(0, iterations);
+        while (done_.load(memory_order_acquire) != threads_ - 1) {
+            this_thread::yield();
+        }
+    }
+
+    int threads() const { return threads_; }
+
+private:
+    void loop(int tid) {
+        uint64_t seen = 0;
+        while (true) {
+            uint64_t gen;
+            while ((gen = generation_.load(memory_order_acquire)) == seen) {
+                this_thread::yield();
+            }
+            seen = gen;
+            if (quit_.load(memory_order_acquire)) return;
+            job_(tid, iterations_);
+            done_.fetch_add(1, memory_order_release);
+        }
+    }
+
+    int threads_;
+    vector<thread> workers_;
+    function<void(int, uint64_t)> job_;
+    uint64_t iterations_ = 0;
+    atomic<uint64_t> generation_{0};
+    atomic<int> done_{0};
+    atomic<bool> quit_{false};
+};
+
+// 每个线程独占一个缓存行的计数器，用于“无竞争”对照
+struct alignas(64) PaddedCounter {
+    atomic<int64_t> value{0};
+};
+
+// 测试-测试-设置自旋锁
+class SpinLock {
+public:
+    void lock() {
+        while (true) {
+            if (!locked_.exchange(true, memory_order_acquire)) return;
+            while (locked_.load(memory_order_relaxed)) cpuRelax();
+        }
+    }
+    void unlock() { locked_.store(false, memory_order_release); }
+
+private:
+    atomic<bool> locked_{false};
+};
+
+// 基于 futex 的互斥锁（Drepper《Futexes Are Tricky》中的 mutex3）
+// 0 = 未加锁，1 = 已加锁且无等待者，2 = 已加锁且可能有等待者
+class FutexLock {
+public:
+    void lock() {
+        int c = 0;
+        if (state_.compare_exchange_strong(c, 1, memory_order_acquire)) return;
+        if (c != 2) c = state_.exchange(2, memory_order_acquire);
+        while (c != 0) {
+            wait(2);
+            c = state_.exchange(2, memory_order_acquire);
+        }
+    }
+
+    void unlock() {
+        if (state_.fetch_sub(1, memory_order_release) != 1) {
+            state_.store(0, memory_order_release);
+            wake(1);
+        }
+    }
+
+private:
+    void wait(int expected) {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        (void)expected;
+        this_thread::yield();
+#endif
+    }
+
+    void wake(int n) {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+#else
+        (void)n;
+#endif
+    }
+
+    atomic<int> state_{0};
+};
+
+// client.cpp 中的全局计数器：两个相邻定义的 atomic 很可能落在同一缓存行
+struct ClientCounters {
+    atomic<int64_t> sent{0};
+    atomic<int64_t> recv{0};
+};
+
+struct PaddedClientCounters {
+    alignas(64) atomic<int64_t> sent{0};
+    alignas(64) atomic<int64_t> recv{0};
+};
+
+thread_local int64_t tls_counter = 0;
+int64_t plain_counter = 0;
+
+void runCase(ThreadTeam& team, const string& name, function<void(int, uint64_t)> job) {
+    team.setJob(std::move(job));
+    auto r = bench::run(name + " x" + to_string(team.threads()), [&](uint64_t iterations) {
+        team.run(iterations);
+    });
+    bench::printRow(r);
+}
+
+void measureAtomics(ThreadTeam& team) {
+    atomic<int64_t> shared{0};
+    vector<PaddedCounter> own(team.threads());
+
+    runCase(team, "fetch_add relaxed 共享", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) shared.fetch_add(1, memory_order_relaxed);
+    });
+    runCase(team, "fetch_add acq_rel 共享", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) shared.fetch_add(1, memory_order_acq_rel);
+    });
+    runCase(team, "fetch_add seq_cst 共享", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) shared.fetch_add(1, memory_order_seq_cst);
+    });
+    runCase(team, "fetch_add relaxed 独占", [&](int tid, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) own[tid].value.fetch_add(1, memory_order_relaxed);
+    });
+    runCase(team, "store seq_cst 独占", [&](int tid, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) own[tid].value.store((int64_t)i, memory_order_seq_cst);
+    });
+    runCase(team, "CAS 循环 共享", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            int64_t cur = shared.load(memory_order_relaxed);
+            while (!shared.compare_exchange_weak(cur, cur + 1, memory_order_acq_rel,
+                                                 memory_order_relaxed)) {
+            }
+        }
+    });
+    doNotOptimizeAway(shared);
+}
+
+template <typename Lock>
+void measureLock(ThreadTeam& team, const string& name) {
+    Lock lock;
+    int64_t counter = 0;
+    runCase(team, name, [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            lock.lock();
+            ++counter;
+            lock.unlock();
+        }
+    });
+    doNotOptimizeAway(counter);
+}
+
+void measureLocks(ThreadTeam& team) {
+    measureLock<mutex>(team, "std::mutex");
+    measureLock<SpinLock>(team, "自旋锁");
+    measureLock<FutexLock>(team, "futex 锁");
+
+    shared_mutex sm;
+    int64_t value = 0;
+    runCase(team, "shared_mutex 读锁", [&](int, uint64_t n) {
+        int64_t sum = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            shared_lock<shared_mutex> guard(sm);
+            sum += value;
+        }
+        doNotOptimizeAway(sum);
+    });
+    runCase(team, "shared_mutex 写锁", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            unique_lock<shared_mutex> guard(sm);
+            ++value;
+        }
+    });
+}
+
+void measureThreadLocal(ThreadTeam& team) {
+    runCase(team, "thread_local 自增", [&](int, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            ++tls_counter;
+            doNotOptimizeAway(tls_counter);
+        }
+    });
+    if (team.threads() == 1) {
+        runCase(team, "普通全局变量自增", [&](int, uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                ++plain_counter;
+                doNotOptimizeAway(plain_counter);
+            }
+        });
+    }
+}
+
+// 线程 0 模拟发送线程：读取两个计数器判断窗口，然后 sent.fetch_add；
+// 其余线程模拟接收回调：recv.fetch_add
+template <typename Counters>
+void measureClientCounters(ThreadTeam& team, const string& name) {
+    Counters c;
+    runCase(team, name, [&](int tid, uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            if (tid == 0) {
+                int64_t inflight = c.sent.load(memory_order_relaxed) - c.recv.load(memory_order_relaxed);
+                doNotOptimizeAway(inflight);
+                c.sent.fetch_add(1, memory_order_relaxed);
+            } else {
+                c.recv.fetch_add(1, memory_order_relaxed);
+            }
+        }
+    });
+}
+
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+    int maxThreads = (int)std::max(2u, thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--threads=", 10) == 0) maxThreads = std::max(1, std::atoi(argv[i] + 10));
+    }
+    vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    for (int t : counts) {
+        ThreadTeam team(t);
+        bench::printHeader("同步原语开销：" + to_string(t) + " 线程");
+        measureAtomics(team);
+        measureLocks(team);
+        measureThreadLocal(team);
+        if (t >= 2) {
+            measureClientCounters<ClientCounters>(team, "client 计数器（相邻）");
+            measureClientCounters<PaddedClientCounters>(team, "client 计数器（缓存行对齐）");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// 展开因子 / 累加器个数扫描：读带宽与归约内核
+// 对 double 数组求和。不开 -ffast-math 时编译器不能重排浮点加法，单累加器的循环
+// 受加法延迟（约 4 个周期）限制；用 static_for 展开为 K 个独立累加器后，
+// 吞吐逐步提高，直到受限于加法单元数量或所在层级的带宽。
+// 每个工作集（L1 / L2 / 最后一级缓存 / 内存）分别扫描 K = 1..16，表中 ns/次为每个元素。
+//
+// 编译：g++ -O2 -std=c++17 unroll_bandwidth.cc -o unroll_bandwidth
+// 运行：./unroll_bandwidth [--tsc] [--perf] [--cpu=N] [--reps=N] [--json=PATH]
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "cache_topology.h"
+#include "../template/unroll.h"
+
+using namespace std;
+
+// K 个独立累加器，每轮处理 K 个元素，剩余部分逐个累加到第 0 个累加器
+template <size_t K>
+NOINLINE double sumUnrolled(const double* p, size_t n) {
+    double acc[K] = {};
+    size_t i = 0;
+    for (; i + K <= n; i += K) {
+        static_for<K>([&](auto j) { acc[j] += p[i + j]; });
+    }
+    for (; i < n; ++i) acc[0] += p[i];
+    double total = 0;
+    static_for<K>([&](auto j) { total += acc[j]; });
+    return total;
+}
+
+struct SweepRow {
+    size_t k;
+    double nsPerElement;
+};
+
+template <size_t K>
+SweepRow measureSum(const vector<double>& data) {
+    auto r = bench::run("K=" + to_string(K), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            doNotOptimizeAway(sumUnrolled<K>(data.data(), data.size()));
+        }
+    });
+    bench::scale(r, data.size());
+    bench::printRow(r);
+    return {K, r.median};
+}
+
+void sweep(const string& label, size_t bytes) {
+    vector<double> data(bytes / sizeof(double));
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (double)(i % 1000) * 0.5;
+    bench::printHeader("求和：" + label + "（" + to_string(bytes >> 10) + " KB，ns/次为每个元素）");
+    vector<SweepRow> rows = {
+        measureSum<1>(data), measureSum<2>(data),  measureSum<3>(data),
+        measureSum<4>(data), measureSum<6>(data),  measureSum<8>(data),
+        measureSum<12>(data), measureSum<16>(data),
+    };
+    double base = rows.front().nsPerElement;
+    cout << "\n" << setw(6) << "K" << setw(14) << "ns/element" << setw(12) << "GB/s"
+         << setw(12) << "speedup" << endl;
+    for (const SweepRow& row : rows) {
+        cout << setw(6) << row.k << fixed << setprecision(3) << setw(14) << row.nsPerElement
+             << setw(12) << sizeof(double) / row.nsPerElement << setw(12)
+             << base / row.nsPerElement << endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::parseArgs(argc, argv);
+    vector<CacheLevel> caches = detectDataCaches();
+    if (caches.empty()) {
+        caches = {{1, "Data", 32 * 1024, 64, "", "default"},
+                  {2, "Unified", 1024 * 1024, 64, "", "default"},
+                  {3, "Unified", 32 * 1024 * 1024, 64, "", "default"}};
+    }
+    // 各层取容量的一半，内存取最后一级缓存的 4 倍（至少 256MB）
+    for (const CacheLevel& c : caches) {
+        sweep("L" + to_string(c.level), c.sizeBytes / 2);
+    }
+    sweep("内存", std::max<size_t>(caches.back().sizeBytes * 4, 256 << 20));
+    return 0;
+}
@@ -0,0 +1,164 @@
+#pragma once
+// bulk_append(container, source...): appends a range in one step, choosing
+// the cheapest operation the container supports:
+//   1. trivially copyable elements from contiguous memory into a container
+//      with resize_and_overwrite (C++23 std::string), or a resize() + data()
+//      container without a range insert: grow once, memcpy. In C++17 no
+//      standard container qualifies; they all take path 2.
+//   2. range insert at end() (vector/string/deque/list already memmove or
+//      reserve internally for forward iterators)
+//   3. reserve (if available and the size is known) + push_back
+//   4. associative insert(first, last)
+// Rvalue sources are moved from. Containers that support none of these are a
+// compile error rather than a silent no-op.
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace _append_details {
+    template <class C, class = void>
+    struct _has_reserve : std::false_type {
+    };
+
+    template <class C>
+    struct _has_reserve<C, std::void_t<decltype(std::declval<C &>().reserve(std::size_t()))>> : std::true_type {
+    };
+
+    template <class C, class = void>
+    struct _has_resize_and_data : std::false_type {
+    };
+
+    template <class C>
+    struct _has_resize_and_data<C, std::void_t<decltype(std::declval<C &>().resize(std::size_t())), decltype(std::declval<C &>().data())>> : std::true_type {
+    };
+
+    struct _keep_size {
+        template <class P>
+        std::size_t operator()(P, std::size_t n) const {
+            return n;
+        }
+    };
+
+    template <class C, class = void>
+    struct _has_resize_and_overwrite : std::false_type {
+    };
+
+    template <class C>
+    struct _has_resize_and_overwrite<C, std::void_t<decltype(std::declval<C &>().resize_and_overwrite(std::size_t(), _keep_size()))>> : std::true_type {
+    };
+
+    template <class C, class It, class = void>
+    struct _has_range_insert : std::false_type {
+    };
+
+    template <class C, class It>
+    struct _has_range_insert<C, It, std::void_t<decltype(std::declval<C &>().insert(std::declval<C &>().end(), std::declval<It>(), std::declval<It>()))>> : std::true_type {
+    };
+
+    template <class C, class It, class = void>
+    struct _has_assoc_insert : std::false_type {
+    };
+
+    template <class C, class It>
+    struct _has_assoc_insert<C, It, std::void_t<decltype(std::declval<C &>().insert(std::declval<It>(), std::declval<It>()))>> : std::true_type {
+    };
+
+    template <class C, class V, class = void>
+    struct _has_push_back : std::false_type {
+    };
+
+    template <class C, class V>
+    struct _has_push_back<C, V, std::void_t<decltype(std::declval<C &>().push_back(std::declval<V>()))>> : std::true_type {
+    };
+
+    template <class R, class = void>
+    struct _is_contiguous_range : std::false_type {
+    };
+
+    template <class R>
+    struct _is_contiguous_range<R, std::enable_if_t<std::is_pointer_v<decltype(std::data(std::declval<R &>()))>, std::void_t<decltype(std::size(std::declval<R &>()))>>> : std::true_type {
+    };
+
+    template <class It>
+    inline constexpr bool _is_forward_v = std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>;
+
+    // Elements that can be appended by memcpy: same trivially copyable type on both sides.
+    template <class C, class T>
+    inline constexpr bool _is_memcpy_append_v = std::is_trivially_copyable_v<T> && std::is_same_v<typename C::value_type, std::remove_cv_t<T>>;
+
+    // The source may lie inside c itself (bulk_append(s, s.data(), s.size())):
+    // growing can reallocate, so such a source is re-based by its offset.
+    template <class C, class T>
+    void _append_memcpy(C &c, T const *p, std::size_t n) {
+        std::size_t old = c.size();
+        T const *base = c.data();
+        bool inside = old != 0 && !std::less<T const *>()(p, base) && std::less<T const *>()(p, base + old);
+        std::size_t off = inside ? static_cast<std::size_t>(p - base) : 0;
+        if constexpr (_has_resize_and_overwrite<C>::value) {
+            c.resize_and_overwrite(old + n, [&] (auto *buf, std::size_t len) {
+                std::memcpy(buf + old, inside ? buf + off : p, n * sizeof(T));
+                return len;
+            });
+        } else {
+            c.resize(old + n);
+            std::memcpy(c.data() + old, inside ? c.data() + off : p, n * sizeof(T));
+        }
+    }
+
+    template <class C, class It>
+    void _append_iter(C &c, It first, It last) {
+        using V = decltype(*first);
+        if constexpr (std::is_pointer_v<It> && _is_memcpy_append_v<C, std::remove_pointer_t<It>> && (_has_resize_and_overwrite<C>::value || (_has_resize_and_data<C>::value && !_has_range_insert<C, It>::value))) {
+            _append_memcpy(c, first, static_cast<std::size_t>(last - first));
+        } else if constexpr (_has_range_insert<C, It>::value) {
+            c.insert(c.end(), first, last);
+        } else if constexpr (_has_push_back<C, V>::value) {
+            if constexpr (_has_reserve<C>::value && _is_forward_v<It>) {
+                c.reserve(c.size() + static_cast<std::size_t>(std::distance(first, last)));
+            }
+            for (; first != last; ++first) c.push_back(*first);
+        } else if constexpr (_has_assoc_insert<C, It>::value) {
+            c.insert(first, last);
+        } else {
+            static_assert(std::is_void_v<It> && false, "bulk_append: container supports neither insert nor push_back");
+        }
+    }
+
+    template <class C, class It>
+    void bulk_append(C &c, It first, It last) {
+        _append_iter(c, first, last);
+    }
+
+    template <class C, class T>
+    void bulk_append(C &c, T const *p, std::size_t n) {
+        _append_iter(c, p, p + n);
+    }
+
+    // Whole ranges; contiguous sources decay to pointers so the memcpy path
+    // applies, rvalue sources are moved element by element.
+    template <class C, class R>
+    void bulk_append(C &c, R &&r) {
+        using Range = std::remove_reference_t<R>;
+        if constexpr (std::is_rvalue_reference_v<R &&> && !std::is_trivially_copyable_v<std::remove_reference_t<decltype(*std::begin(r))>>) {
+            _append_iter(c, std::make_move_iterator(std::begin(r)), std::make_move_iterator(std::end(r)));
+        } else if constexpr (_is_contiguous_range<Range>::value) {
+            auto *p = std::data(r);
+            _append_iter(c, p, p + std::size(r));
+        } else {
+            _append_iter(c, std::begin(r), std::end(r));
+        }
+    }
+}
+
+using _append_details::bulk_append;
+
+// Usage:
+//
+// std::vector<char> out;
+// bulk_append(out, header, header_len);     // memcpy-able: one grow + memmove
+// bulk_append(out, std::string_view(body));
+// bulk_append(names, std::move(more_names));  // strings are moved, not copied
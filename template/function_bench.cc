@@ -0,0 +1,132 @@
+// Callback cost: a raw lambda passed as a template parameter, function_ref,
+// inplace_function and std::function.
+//   call:      invoking an already-built callback through a non-inlined loop
+//   build+call: creating a fresh callback per request (done-closure pattern)
+// for a small capture (fits every small buffer) and a 48-byte capture
+// (beyond std::function's small buffer on libstdc++). Reports ns per call and
+// heap allocations per call.
+//
+// Run: build/function_bench [--reps=N] [--target_ms=X] [--json=PATH]
+
+#include "../performance/bench.h"
+#include "function_ref.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+
+static std::size_t g_allocs = 0;
+
+void *operator new(std::size_t n) {
+  ++g_allocs;
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+constexpr int kCalls = 1000;
+
+// Heap allocations per call go into the row name.
+template <class Fn> void measure(const char *method, Fn fn) {
+  fn();
+  std::size_t before = g_allocs;
+  fn();
+  double allocs = double(g_allocs - before) / kCalls;
+  char name[96];
+  std::snprintf(name, sizeof(name), "%s, %.2f allocs/call", method, allocs);
+  auto r = bench::run(name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      fn();
+  });
+  bench::scale(r, kCalls);
+  bench::printRow(r);
+}
+
+// Call loops kept out of line so the callable cannot be inlined into them.
+
+template <class F> NOINLINE uint64_t call_template(F &f) {
+  uint64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+    sum += f(i);
+  return sum;
+}
+
+NOINLINE uint64_t call_ref(function_ref<uint64_t(int)> f) {
+  uint64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+    sum += f(i);
+  return sum;
+}
+
+NOINLINE uint64_t call_inplace(inplace_function<uint64_t(int), 64> const &f) {
+  uint64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+    sum += f(i);
+  return sum;
+}
+
+NOINLINE uint64_t call_std(std::function<uint64_t(int)> const &f) {
+  uint64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+    sum += f(i);
+  return sum;
+}
+
+// One callback built per request and handed to code that cannot see the
+// callable, like a done-closure passed into the RPC layer.
+
+template <class Callback>
+NOINLINE uint64_t complete(Callback const &done, int i) {
+  return done(i);
+}
+
+template <class Callback, class Make>
+NOINLINE uint64_t build_and_call(Make make) {
+  uint64_t sum = 0;
+  for (int i = 0; i < kCalls; ++i)
+    sum += complete<Callback>(make(i), i);
+  return sum;
+}
+
+template <class Make> void run_case(const char *capture, Make make) {
+  auto f = make(1);
+  inplace_function<uint64_t(int), 64> inplace = f;
+  std::function<uint64_t(int)> stdfn = f;
+
+  bench::printHeader(std::string(capture) + " capture, ns/call");
+  measure("call: lambda (template)",
+          [&] { doNotOptimizeAway(call_template(f)); });
+  measure("call: function_ref", [&] { doNotOptimizeAway(call_ref(f)); });
+  measure("call: inplace_function",
+          [&] { doNotOptimizeAway(call_inplace(inplace)); });
+  measure("call: std::function",
+          [&] { doNotOptimizeAway(call_std(stdfn)); });
+  measure("build+call: inplace_function", [&] {
+    doNotOptimizeAway(
+        build_and_call<inplace_function<uint64_t(int), 64>>(make));
+  });
+  measure("build+call: std::function", [&] {
+    doNotOptimizeAway(build_and_call<std::function<uint64_t(int)>>(make));
+  });
+}
+
+int main(int argc, char *argv[]) {
+  bench::parseArgs(argc, argv);
+  run_case("8-byte", [](int seed) {
+    uint64_t k = seed * 31;
+    return [k](int x) -> uint64_t { return k ^ x; };
+  });
+  run_case("48-byte", [](int seed) {
+    uint64_t a = seed, b = seed * 3, c = seed * 5, d = seed * 7,
+             e = seed * 11, g = seed * 13;
+    return [a, b, c, d, e, g](int x) -> uint64_t {
+      return (a + x) ^ b ^ c ^ d ^ e ^ g;
+    };
+  });
+  return 0;
+}
@@ -0,0 +1,190 @@
+#pragma once
+// Callable wrappers that never allocate.
+//
+// function_ref<R(Args...)>: non-owning reference to any callable, two
+// pointers wide. The callable must outlive the function_ref (pass it down as
+// a parameter, do not store it).
+//
+// inplace_function<R(Args...), Capacity>: owning, copyable, stores the
+// callable in a fixed in-object buffer. A callable that does not fit is a
+// compile error instead of a heap allocation.
+//
+// Both accept callables whose result converts to R; with R = void the result
+// is discarded (the same split as invoke_expr in invoke.cc).
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace _function_details {
+    template <class R, class F, class ...Args>
+    R _invoke(F &f, Args &&...args) {
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(f, std::forward<Args>(args)...);
+        } else {
+            return std::invoke(f, std::forward<Args>(args)...);
+        }
+    }
+
+    template <class Sig>
+    class function_ref;
+
+    template <class R, class ...Args>
+    class function_ref<R(Args...)> {
+        union _target {
+            void *obj;
+            void (*fn)();
+        } target;
+        R (*thunk)(_target, Args...);
+
+    public:
+        template <class F, std::enable_if_t<!std::is_same_v<std::decay_t<F>, function_ref> && std::is_invocable_r_v<R, F &, Args...>, int> = 0>
+        function_ref(F &&f) noexcept {
+            using Fn = std::remove_reference_t<F>;
+            if constexpr (std::is_function_v<std::remove_pointer_t<Fn>>) {
+                // Function pointers are stored by value: the pointer itself is often a temporary.
+                target.fn = reinterpret_cast<void (*)()>(static_cast<std::remove_pointer_t<Fn> *>(f));
+                thunk = [] (_target t, Args ...args) -> R {
+                    auto *fp = reinterpret_cast<std::remove_pointer_t<Fn> *>(t.fn);
+                    return _invoke<R>(fp, std::forward<Args>(args)...);
+                };
+            } else {
+                target.obj = const_cast<void *>(static_cast<void const *>(std::addressof(f)));
+                thunk = [] (_target t, Args ...args) -> R {
+                    return _invoke<R>(*static_cast<Fn *>(t.obj), std::forward<Args>(args)...);
+                };
+            }
+        }
+
+        R operator()(Args ...args) const {
+            return thunk(target, std::forward<Args>(args)...);
+        }
+    };
+
+    template <class Sig, std::size_t Capacity = 32, std::size_t Align = alignof(std::max_align_t)>
+    class inplace_function;
+
+    template <class R, class ...Args, std::size_t Capacity, std::size_t Align>
+    class inplace_function<R(Args...), Capacity, Align> {
+        // The call pointer lives in the object itself so a call is one
+        // indirect jump; copy/move/destroy go through the shared table.
+        struct _vtable {
+            void (*copy)(void *, void const *);
+            void (*move)(void *, void *);
+            void (*destroy)(void *);
+        };
+
+        template <class F>
+        static R _call(void *p, Args ...args) {
+            return _invoke<R>(*static_cast<F *>(p), std::forward<Args>(args)...);
+        }
+
+        [[noreturn]] static R _call_empty(void *, Args...) {
+            throw std::bad_function_call();
+        }
+
+        template <class F>
+        static constexpr _vtable _vtable_for = {
+            [] (void *dst, void const *src) {
+                ::new (dst) F(*static_cast<F const *>(src));
+            },
+            [] (void *dst, void *src) {
+                ::new (dst) F(std::move(*static_cast<F *>(src)));
+                static_cast<F *>(src)->~F();
+            },
+            [] (void *p) {
+                static_cast<F *>(p)->~F();
+            },
+        };
+
+        alignas(Align) unsigned char storage[Capacity];
+        R (*call)(void *, Args...) = _call_empty;
+        _vtable const *vtable = nullptr;
+
+    public:
+        inplace_function() noexcept = default;
+
+        inplace_function(std::nullptr_t) noexcept {
+        }
+
+        template <class F, std::enable_if_t<!std::is_same_v<std::decay_t<F>, inplace_function> && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>, int> = 0>
+        inplace_function(F &&f) {
+            using Fn = std::decay_t<F>;
+            static_assert(sizeof(Fn) <= Capacity, "callable too large for inplace_function, raise Capacity");
+            static_assert(Align % alignof(Fn) == 0, "callable over-aligned for inplace_function, raise Align");
+            static_assert(std::is_copy_constructible_v<Fn>, "inplace_function needs a copyable callable");
+            ::new (static_cast<void *>(storage)) Fn(std::forward<F>(f));
+            call = _call<Fn>;
+            vtable = &_vtable_for<Fn>;
+        }
+
+        inplace_function(inplace_function const &that) : call(that.call), vtable(that.vtable) {
+            if (vtable) vtable->copy(storage, that.storage);
+        }
+
+        inplace_function(inplace_function &&that) noexcept : call(that.call), vtable(that.vtable) {
+            if (vtable) {
+                vtable->move(storage, that.storage);
+                that.call = _call_empty;
+                that.vtable = nullptr;
+            }
+        }
+
+        inplace_function &operator=(inplace_function const &that) {
+            if (this != &that) {
+                reset();
+                if (that.vtable) that.vtable->copy(storage, that.storage);
+                call = that.call;
+                vtable = that.vtable;
+            }
+            return *this;
+        }
+
+        inplace_function &operator=(inplace_function &&that) noexcept {
+            if (this != &that) {
+                reset();
+                if (that.vtable) {
+                    that.vtable->move(storage, that.storage);
+                    call = that.call;
+                    vtable = that.vtable;
+                    that.call = _call_empty;
+                    that.vtable = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        ~inplace_function() {
+            reset();
+        }
+
+        void reset() noexcept {
+            if (vtable) {
+                vtable->destroy(storage);
+                call = _call_empty;
+                vtable = nullptr;
+            }
+        }
+
+        explicit operator bool() const noexcept {
+            return vtable != nullptr;
+        }
+
+        R operator()(Args ...args) const {
+            return call(const_cast<unsigned char *>(storage), std::forward<Args>(args)...);
+        }
+    };
+}
+
+using _function_details::function_ref;
+using _function_details::inplace_function;
+
+// Usage:
+//
+// void for_each_stream(function_ref<void(Stream &)> fn);  // no template, no allocation
+// for_each_stream([&] (Stream &s) { total += s.pending(); });
+//
+// inplace_function<void(int), 48> done = [req, start] (int status) { ... };
+// done(0);
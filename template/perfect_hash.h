@@ -0,0 +1,204 @@
+#pragma once
+// Compile-time minimal perfect hash over a fixed set of string keys.
+//
+//     constexpr auto methods = make_perfect_hash("Echo", "Get", "Put", "Delete");
+//     static_assert(methods.find("Put") == 2);
+//     std::size_t i = methods.find(name);            // methods.size() if absent
+//     methods.dispatch(name, on_unknown, on_echo, on_get, on_put, on_delete);
+//
+// Construction runs entirely in constexpr, hash-and-displace style. Every
+// key is hashed once (64 bit, 8 bytes per step) and the hash picks a bucket. Buckets
+// are placed largest first: each one gets the smallest displacement that
+// sends all its keys to free slots of an N-slot table. Lookup is one pass
+// over the key, two multiplies per mix, and one full-hash check plus one
+// string compare at the single candidate slot. dispatch() calls the matched
+// handler through a table of function pointers, so there is no switch or
+// compare chain. A key set that cannot be placed (duplicate keys, or a 64-bit
+// hash collision) fails to compile.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace _perfect_hash_details {
+    // Little-endian value of n bytes. At run time a plain load of constant width.
+    constexpr std::uint64_t _load(char const *p, std::size_t n) {
+        std::uint64_t w = 0;
+#if (defined(__GNUC__) || defined(__clang__)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (!__builtin_is_constant_evaluated()) {
+            std::memcpy(&w, p, n);
+            return w;
+        }
+#endif
+        for (std::size_t i = 0; i < n; ++i) {
+            w |= std::uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+        }
+        return w;
+    }
+
+    // 8 bytes per step, the tail in 4/2/1-byte pieces, so every load has a
+    // constant width both in constexpr and at run time.
+    constexpr std::uint64_t _hash(std::string_view s) {
+        char const *p = s.data();
+        std::size_t n = s.size();
+        std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+        for (; n >= 8; p += 8, n -= 8) {
+            h = (h ^ _load(p, 8)) * 0xff51afd7ed558ccdULL;
+            h ^= h >> 32;
+        }
+        std::uint64_t w = 0;
+        std::size_t shift = 0;
+        if (n & 4) {
+            w = _load(p, 4);
+            p += 4;
+            shift = 32;
+        }
+        if (n & 2) {
+            w |= _load(p, 2) << shift;
+            p += 2;
+            shift += 16;
+        }
+        if (n & 1) {
+            w |= _load(p, 1) << shift;
+        }
+        return (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    }
+
+    // splitmix64 finalizer, applied before every range reduction.
+    constexpr std::uint64_t _mix(std::uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    // Maps h uniformly onto [0, n) with a multiply instead of a division.
+    constexpr std::size_t _reduce(std::uint64_t h, std::size_t n) {
+        return static_cast<std::size_t>(((h >> 32) * n) >> 32);
+    }
+
+    constexpr std::size_t _slot_of(std::uint64_t h, std::uint32_t disp, std::size_t n) {
+        return _reduce(_mix(h ^ (disp * 0x9e3779b97f4a7c15ULL)), n);
+    }
+
+    template <std::size_t N>
+    class perfect_hash {
+        static_assert(N > 0, "perfect_hash needs at least one key");
+        static_assert(N < (1u << 16), "perfect_hash slot index is 16 bits");
+
+        std::array<std::uint32_t, N> disp{};        // per bucket
+        std::array<std::uint64_t, N> slot_hash{};   // full hash of the key in each slot
+        std::array<std::string_view, N> slot_key{};
+        std::array<std::uint16_t, N> slot_index{};  // position in the original key list
+
+        template <class R, class Tuple, std::size_t I>
+        static R _call(Tuple &handlers) {
+            return std::get<I>(handlers)();
+        }
+
+        template <class R, class Tuple, std::size_t ...Is>
+        static R _dispatch(std::size_t i, Tuple &handlers, std::index_sequence<Is...>) {
+            using thunk = R (*)(Tuple &);
+            static constexpr thunk table[] = {&_call<R, Tuple, Is>...};
+            return table[i](handlers);
+        }
+
+    public:
+        constexpr explicit perfect_hash(std::array<std::string_view, N> const &keys) {
+            std::array<std::uint64_t, N> hash{};
+            std::array<std::size_t, N> bucket{};
+            std::array<std::size_t, N> bucket_size{};
+            for (std::size_t k = 0; k < N; ++k) {
+                hash[k] = _hash(keys[k]);
+                bucket[k] = _reduce(_mix(hash[k]), N);
+                ++bucket_size[bucket[k]];
+                for (std::size_t j = 0; j < k; ++j) {
+                    if (hash[j] == hash[k]) throw std::logic_error("perfect_hash: duplicate key or 64-bit hash collision");
+                }
+            }
+
+            // Bucket order: largest first (insertion sort, N is small).
+            std::array<std::size_t, N> order{};
+            for (std::size_t b = 0; b < N; ++b) {
+                std::size_t j = b;
+                while (j > 0 && bucket_size[order[j - 1]] < bucket_size[b]) {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = b;
+            }
+
+            std::array<bool, N> taken{};
+            for (std::size_t ob = 0; ob < N && bucket_size[order[ob]] != 0; ++ob) {
+                std::size_t b = order[ob];
+                for (std::uint32_t d = 0;; ++d) {
+                    if (d == (1u << 16)) throw std::logic_error("perfect_hash: no displacement found");
+                    std::array<bool, N> mine{};
+                    bool ok = true;
+                    for (std::size_t k = 0; k < N && ok; ++k) {
+                        if (bucket[k] != b) continue;
+                        std::size_t s = _slot_of(hash[k], d, N);
+                        ok = !taken[s] && !mine[s];
+                        mine[s] = true;
+                    }
+                    if (!ok) continue;
+                    disp[b] = d;
+                    for (std::size_t k = 0; k < N; ++k) {
+                        if (bucket[k] != b) continue;
+                        std::size_t s = _slot_of(hash[k], d, N);
+                        taken[s] = true;
+                        slot_hash[s] = hash[k];
+                        slot_key[s] = keys[k];
+                        slot_index[s] = static_cast<std::uint16_t>(k);
+                    }
+                    break;
+                }
+            }
+        }
+
+        static constexpr std::size_t size() {
+            return N;
+        }
+
+        // Index of key in the original list, or size() if it is not one of the keys.
+        constexpr std::size_t find(std::string_view key) const {
+            std::uint64_t h = _hash(key);
+            std::size_t s = _slot_of(h, disp[_reduce(_mix(h), N)], N);
+            if (slot_hash[s] != h || slot_key[s] != key) return N;
+            return slot_index[s];
+        }
+
+        constexpr bool contains(std::string_view key) const {
+            return find(key) != N;
+        }
+
+        // Calls the handler at the matched key's position (handlers in key
+        // order), or fallback() for unknown keys. All results convert to the
+        // fallback's result type.
+        template <class Fallback, class ...Hs>
+        decltype(auto) dispatch(std::string_view key, Fallback &&fallback, Hs &&...handlers) const {
+            static_assert(sizeof...(Hs) == N, "dispatch needs one handler per key");
+            using R = std::invoke_result_t<Fallback &>;
+            std::size_t i = find(key);
+            if (i == N) return static_cast<R>(fallback());
+            std::tuple<Hs &...> tuple(handlers...);
+            return _dispatch<R>(i, tuple, std::make_index_sequence<N>{});
+        }
+    };
+
+    template <class ...Ss>
+    constexpr auto make_perfect_hash(Ss const &...keys) {
+        return perfect_hash<sizeof...(Ss)>(std::array<std::string_view, sizeof...(Ss)>{std::string_view(keys)...});
+    }
+}
+
+using _perfect_hash_details::perfect_hash;
+using _perfect_hash_details::make_perfect_hash;
@@ -0,0 +1,135 @@
+// Method-name routing: compile-time perfect hash against
+// std::unordered_map<std::string, int> and a linear strcmp chain, on a
+// stream of request names (90% known methods, 10% unknown). Also compares
+// perfect_hash::dispatch with unordered_map<std::string, std::function>.
+//
+// Run: build/perfect_hash_bench [--reps=N] [--target_ms=X] [--json=PATH]
+
+#include "../performance/bench.h"
+#include "perfect_hash.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define METHODS                                                                \
+  "Echo", "Ping", "GetUser", "SetUser", "DeleteUser", "ListUsers",             \
+      "UpdateUser", "CreateUser", "Login", "Logout", "Refresh", "Health",      \
+      "Stats", "Query", "Scan", "Count", "BatchGet", "BatchPut", "Watch",      \
+      "Stream"
+
+static constexpr const char *kMethods[] = {METHODS};
+constexpr std::size_t kNum = sizeof(kMethods) / sizeof(kMethods[0]);
+static constexpr auto kTable = make_perfect_hash(METHODS);
+
+NOINLINE std::size_t by_perfect_hash(std::vector<std::string> const &names) {
+  std::size_t sum = 0;
+  for (std::string const &n : names)
+    sum += kTable.find(n);
+  return sum;
+}
+
+NOINLINE std::size_t
+by_unordered_map(std::unordered_map<std::string, std::size_t> const &map,
+                 std::vector<std::string> const &names) {
+  std::size_t sum = 0;
+  for (std::string const &n : names) {
+    auto it = map.find(n);
+    sum += it == map.end() ? kNum : it->second;
+  }
+  return sum;
+}
+
+NOINLINE std::size_t by_strcmp(std::vector<std::string> const &names) {
+  std::size_t sum = 0;
+  for (std::string const &n : names) {
+    std::size_t i = 0;
+    while (i < kNum && std::strcmp(n.c_str(), kMethods[i]) != 0)
+      ++i;
+    sum += i;
+  }
+  return sum;
+}
+
+// Dispatch: each handler adds a different constant.
+
+template <std::size_t... Is>
+NOINLINE uint64_t dispatch_perfect_hash(std::vector<std::string> const &names,
+                                        std::index_sequence<Is...>) {
+  uint64_t total = 0;
+  for (std::string const &n : names)
+    kTable.dispatch(
+        n, [&] { total += 1000; }, [&] { total += Is * 7 + 1; }...);
+  return total;
+}
+
+NOINLINE uint64_t dispatch_unordered_map(
+    std::unordered_map<std::string, std::function<void()>> const &map,
+    std::vector<std::string> const &names, uint64_t &total) {
+  total = 0;
+  for (std::string const &n : names) {
+    auto it = map.find(n);
+    if (it == map.end())
+      total += 1000;
+    else
+      it->second();
+  }
+  return total;
+}
+
+template <class Fn>
+void measure(const char *method, std::size_t lookups, Fn fn) {
+  auto r = bench::run(method, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      fn();
+  });
+  bench::scale(r, lookups);
+  bench::printRow(r);
+}
+
+int main(int argc, char *argv[]) {
+  bench::parseArgs(argc, argv);
+
+  std::mt19937 rng(42);
+  std::vector<std::string> names(4096);
+  for (std::string &n : names)
+    n = rng() % 10 ? kMethods[rng() % kNum]
+                   : "Unknown" + std::to_string(rng() % 100);
+
+  std::unordered_map<std::string, std::size_t> map;
+  std::unordered_map<std::string, std::function<void()>> handlers;
+  uint64_t total = 0;
+  for (std::size_t i = 0; i < kNum; ++i) {
+    map[kMethods[i]] = i;
+    handlers[kMethods[i]] = [&total, i] { total += i * 7 + 1; };
+  }
+
+  std::size_t expect = by_strcmp(names);
+  uint64_t dispatched = dispatch_perfect_hash(names, std::make_index_sequence<kNum>{});
+  if (by_perfect_hash(names) != expect ||
+      by_unordered_map(map, names) != expect ||
+      dispatch_unordered_map(handlers, names, total) != dispatched) {
+    std::fprintf(stderr, "lookups disagree\n");
+    return 1;
+  }
+
+  bench::printHeader(std::to_string(kNum) + " methods, ns/lookup");
+  measure("find: perfect_hash", names.size(),
+          [&] { doNotOptimizeAway(by_perfect_hash(names)); });
+  measure("find: unordered_map<string>", names.size(),
+          [&] { doNotOptimizeAway(by_unordered_map(map, names)); });
+  measure("find: strcmp chain", names.size(),
+          [&] { doNotOptimizeAway(by_strcmp(names)); });
+  measure("dispatch: perfect_hash", names.size(), [&] {
+    doNotOptimizeAway(
+        dispatch_perfect_hash(names, std::make_index_sequence<kNum>{}));
+  });
+  measure("dispatch: unordered_map<string, function>", names.size(), [&] {
+    doNotOptimizeAway(dispatch_unordered_map(handlers, names, total));
+  });
+  return 0;
+}
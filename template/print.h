@@ -9,11 +9,350 @@
 #include <string_view>
 #include <optional>
 #include <variant>
+#include <algorithm>
+#include <cerrno>
+#include <array>
+#include <charconv>
+#include <limits>
+#include <tuple>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace _print_details {
+    // Character buffer used as a fast alternative to std::ostream.
+    // Without a sink it grows in memory; with a FILE * or fd sink it flushes in
+    // large chunks whenever it fills up (and on destruction).
+    class print_buffer {
+        std::unique_ptr<char[]> owned;
+        char *buf = nullptr;
+        std::size_t len = 0;
+        std::size_t cap = 0;
+        std::FILE *fp = nullptr;
+        int fd = -1;
+
+        bool has_sink() const {
+            return fp || fd >= 0;
+        }
+
+        void write_out(char const *s, std::size_t n) {
+            if (fp) {
+                std::fwrite(s, 1, n, fp);
+                return;
+            }
+#if __has_include(<unistd.h>)
+            while (n > 0) {
+                auto w = ::write(fd, s, n);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    return;
+                }
+                s += w;
+                n -= static_cast<std::size_t>(w);
+            }
+#endif
+        }
+
+        void grow(std::size_t need) {
+            std::size_t newcap = std::max<std::size_t>(cap * 2, 256);
+            while (newcap < need) newcap *= 2;
+            std::unique_ptr<char[]> p(new char[newcap]);
+            if (len) std::memcpy(p.get(), buf, len);
+            owned = std::move(p);
+            buf = owned.get();
+            cap = newcap;
+        }
+
+    public:
+        print_buffer() = default;
+
+        explicit print_buffer(std::FILE *fp_, std::size_t capacity = 64 * 1024) : fp(fp_) {
+            grow(capacity);
+        }
+
+        explicit print_buffer(int fd_, std::size_t capacity = 64 * 1024) : fd(fd_) {
+            grow(capacity);
+        }
+
+        // Caller-supplied storage; without a sink it moves to the heap once it overflows.
+        print_buffer(char *data_, std::size_t capacity, std::FILE *fp_ = nullptr) : buf(data_), cap(capacity), fp(fp_) {
+        }
+
+        print_buffer(print_buffer const &) = delete;
+        print_buffer &operator=(print_buffer const &) = delete;
+
+        ~print_buffer() {
+            flush();
+        }
+
+        char const *data() const {
+            return buf;
+        }
+
+        std::size_t size() const {
+            return len;
+        }
+
+        std::string_view view() const {
+            return {buf, len};
+        }
+
+        void clear() {
+            len = 0;
+        }
+
+        // Returns room for at least n contiguous bytes; finish with commit().
+        char *prepare(std::size_t n) {
+            if (n > cap - len) {
+                if (has_sink()) flush();
+                if (n > cap - len) grow(len + n);
+            }
+            return buf + len;
+        }
+
+        void commit(std::size_t n) {
+            len += n;
+        }
+
+        // Capacity hint: flushes early or grows owned storage, but never moves
+        // caller-supplied storage to the heap.
+        void reserve(std::size_t n) {
+            if (n <= cap - len) return;
+            if (has_sink()) flush();
+            else if (owned || !buf) grow(len + n);
+        }
+
+        void append(char const *s, std::size_t n) {
+            if (n > cap - len) {
+                if (has_sink()) {
+                    flush();
+                    if (n > cap) {
+                        write_out(s, n);
+                        return;
+                    }
+                } else {
+                    grow(len + n);
+                }
+            }
+            std::memcpy(buf + len, s, n);
+            len += n;
+        }
+
+        void put(char c) {
+            if (len == cap) {
+                if (has_sink()) flush();
+                else grow(len + 1);
+            }
+            buf[len++] = c;
+        }
+
+        void flush() {
+            if (has_sink() && len) {
+                write_out(buf, len);
+                len = 0;
+            }
+        }
+
+        // Hand the contents to a FILE * in one fwrite, e.g. after formatting into a memory buffer.
+        void flush_to(std::FILE *out) {
+            if (len) std::fwrite(buf, 1, len, out);
+            len = 0;
+        }
+    };
+
+    // Sink that only counts bytes; drives the same printers to compute the exact output size.
+    class _size_counter {
+        std::size_t len = 0;
+
+    public:
+        std::size_t size() const {
+            return len;
+        }
+
+        void reserve(std::size_t) {
+        }
+
+        void append(char const *, std::size_t n) {
+            len += n;
+        }
+
+        void put(char) {
+            ++len;
+        }
+    };
+
+    template <class Os>
+    inline constexpr bool _is_ostream_v = std::is_base_of_v<std::ostream, Os>;
+
+    template <class Sink>
+    struct _is_buffer_sink : std::false_type {
+    };
+
+    template <>
+    struct _is_buffer_sink<print_buffer> : std::true_type {
+    };
+
+    template <>
+    struct _is_buffer_sink<_size_counter> : std::true_type {
+    };
+
+    // streambuf that forwards into a buffer sink, used for types that can only
+    // be formatted through operator<< (or do_print).
+    template <class Sink>
+    class _buffer_streambuf : public std::streambuf {
+    public:
+        Sink *target = nullptr;
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) target->put(traits_type::to_char_type(ch));
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(char const *s, std::streamsize n) override {
+            target->append(s, static_cast<std::size_t>(n));
+            return n;
+        }
+    };
+
+    template <class Sink, class Fn>
+    void _print_via_ostream(Sink &buf, Fn &&fn) {
+        thread_local _buffer_streambuf<Sink> sb;
+        thread_local std::ostream os(&sb);
+        Sink *saved = sb.target;
+        sb.target = &buf;
+        os.flags(std::ios_base::dec | std::ios_base::skipws);
+        os.precision(6);
+        os.width(0);
+        os.fill(' ');
+        fn(os);
+        sb.target = saved;
+    }
+
+    template <class T>
+    struct _is_to_chars_integer : std::bool_constant<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> && !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>> {
+    };
+
+    // Integers and floats go through std::to_chars (floats as %g, matching the
+    // default ostream format); string-likes are copied; anything else falls back to operator<<.
+    template <class Sink, class T, std::enable_if_t<_is_buffer_sink<Sink>::value, int> = 0>
+    Sink &operator<<(Sink &buf, T const &t) {
+        if constexpr (std::is_convertible_v<T const &, std::string_view>) {
+            std::string_view sv = t;
+            buf.append(sv.data(), sv.size());
+        } else if constexpr (std::is_same_v<T, char>) {
+            buf.put(t);
+        } else if constexpr (_is_to_chars_integer<T>::value) {
+            char tmp[24];
+            buf.append(tmp, static_cast<std::size_t>(std::to_chars(tmp, tmp + sizeof(tmp), t).ptr - tmp));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            char tmp[64];
+            buf.append(tmp, static_cast<std::size_t>(std::to_chars(tmp, tmp + sizeof(tmp), t, std::chars_format::general, 6).ptr - tmp));
+        } else {
+            _print_via_ostream(buf, [&] (std::ostream &os) {
+                os << t;
+            });
+        }
+        return buf;
+    }
+
+    // First byte in [p, end) that needs escaping: delim, backslash and, in JSON
+    // mode, control characters below 0x20. Scans 32 (AVX2) or 16 (SSE2) bytes
+    // per step; the tail and other targets go byte by byte.
+    inline char const *_find_escape(char const *p, char const *end, char delim, bool json) {
+#if defined(__AVX2__)
+        __m256i const vd = _mm256_set1_epi8(delim);
+        __m256i const vb = _mm256_set1_epi8('\\');
+        __m256i const vc = _mm256_set1_epi8(0x1f);
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+            __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, vd), _mm256_cmpeq_epi8(v, vb));
+            if (json) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(v, vc), v));
+            if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit))) return p + __builtin_ctz(mask);
+        }
+#endif
+#if defined(__SSE2__)
+        __m128i const ud = _mm_set1_epi8(delim);
+        __m128i const ub = _mm_set1_epi8('\\');
+        __m128i const uc = _mm_set1_epi8(0x1f);
+        for (; end - p >= 16; p += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+            __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, ud), _mm_cmpeq_epi8(v, ub));
+            if (json) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(v, uc), v));
+            if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit))) return p + __builtin_ctz(mask);
+        }
+#endif
+        for (; p != end; ++p) {
+            auto c = static_cast<unsigned char>(*p);
+            if (*p == delim || c == '\\' || (json && c < 0x20)) return p;
+        }
+        return end;
+    }
+
+    // Adapts an ostream to the put/append interface of the buffer sinks.
+    struct _ostream_sink {
+        std::ostream &os;
+
+        void put(char c) {
+            os.put(c);
+        }
+
+        void append(char const *s, std::size_t n) {
+            os.write(s, static_cast<std::streamsize>(n));
+        }
+    };
+
+    // Escapes s between delim quotes, copying clean runs in bulk. The default
+    // mode matches std::quoted; JSON mode also escapes control characters so
+    // the result is a valid JSON string literal when delim is '"'.
+    template <class Sink>
+    void _append_quoted(Sink &buf, std::string_view s, char delim, bool json = false) {
+        if constexpr (_is_ostream_v<Sink>) {
+            _ostream_sink os{buf};
+            _append_quoted(os, s, delim, json);
+        } else {
+            buf.put(delim);
+            char const *p = s.data();
+            char const *end = p + s.size();
+            while (true) {
+                char const *q = _find_escape(p, end, delim, json);
+                buf.append(p, static_cast<std::size_t>(q - p));
+                if (q == end) break;
+                char esc[6] = {'\\', *q};
+                std::size_t n = 2;
+                switch (*q) {
+                case '\b': esc[1] = 'b'; break;
+                case '\f': esc[1] = 'f'; break;
+                case '\n': esc[1] = 'n'; break;
+                case '\r': esc[1] = 'r'; break;
+                case '\t': esc[1] = 't'; break;
+                default:
+                    if (static_cast<unsigned char>(*q) < 0x20) {
+                        char const *hex = "0123456789abcdef";
+                        esc[1] = 'u';
+                        esc[2] = esc[3] = '0';
+                        esc[4] = hex[*q >> 4];
+                        esc[5] = hex[*q & 15];
+                        n = 6;
+                    }
+                }
+                buf.append(esc, n);
+                p = q + 1;
+            }
+            buf.put(delim);
+        }
+    }
+
     template <class T, class = void>
     struct _printer {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
             os << t;
         }
 
@@ -79,7 +418,7 @@ namespace _print_details {
     };
 
     template <class T, class U>
-    struct _enable_if_has_print<T, U, std::void_t<decltype(std::declval<T const &>().do_print(std::declval<std::ostream &>))>> {
+    struct _enable_if_has_print<T, U, std::void_t<decltype(std::declval<T const &>().do_print(std::declval<std::ostream &>()))>> {
         using type = U;
     };
 
@@ -150,16 +489,214 @@ namespace _print_details {
         using type = U;
     };
 
+    // Structs can opt into field-wise printing with
+    //     auto print_fields() const { return std::tie(a, b); }
+    // and optionally name the fields with
+    //     static constexpr std::array<std::string_view, 2> print_names = {"a", "b"};
+    template <class T, class U = void, class = void>
+    struct _enable_if_has_fields {
+        using not_type = U;
+    };
+
+    template <class T, class U>
+    struct _enable_if_has_fields<T, U, std::void_t<decltype(std::tuple_size<decltype(std::declval<T const &>().print_fields())>::value)>> {
+        using type = U;
+    };
+
+    template <class T, class = void>
+    struct _is_std_array : std::false_type {
+    };
+
+    template <class T, std::size_t N>
+    struct _is_std_array<std::array<T, N>, void> : std::true_type {
+    };
+
+    // Upper bound on the printed width of a value, known at compile time for
+    // fixed-width types (bounded == false for strings, containers, ...).
+    template <class T, class = void>
+    struct _max_width {
+        static constexpr bool bounded = false;
+        static constexpr std::size_t value = 0;
+    };
+
+    template <class T, class = void>
+    struct _format_plan {
+        static constexpr bool fixed_shape = false;
+    };
+
+    template <std::size_t W>
+    struct _fixed_width {
+        static constexpr bool bounded = true;
+        static constexpr std::size_t value = W;
+    };
+
+    template <class T>
+    struct _max_width<T, std::enable_if_t<_is_to_chars_integer<T>::value>> : _fixed_width<std::numeric_limits<T>::digits10 + 2> {
+    };
+
+    template <class T>
+    struct _max_width<T, std::enable_if_t<std::is_floating_point_v<T>>> : _fixed_width<24> {
+    };
+
+    template <>
+    struct _max_width<bool, void> : _fixed_width<5> {
+    };
+
+    template <>
+    struct _max_width<char, void> : _fixed_width<4> {
+    };
+
+    template <>
+    struct _max_width<std::nullptr_t, void> : _fixed_width<7> {
+    };
+
+    template <>
+    struct _max_width<std::nullopt_t, void> : _fixed_width<7> {
+    };
+
+    template <>
+    struct _max_width<std::monostate, void> : _fixed_width<9> {
+    };
+
+    template <class T>
+    struct _max_width<std::optional<T>, void> {
+        static constexpr bool bounded = _max_width<T>::bounded;
+        static constexpr std::size_t value = std::max<std::size_t>(_max_width<T>::value, 7);
+    };
+
+    template <class ...Ts>
+    struct _max_width<std::variant<Ts...>, void> {
+        static constexpr bool bounded = (_max_width<Ts>::bounded && ...);
+        static constexpr std::size_t value = std::max({std::size_t(0), _max_width<Ts>::value...});
+    };
+
+    template <class T>
+    struct _max_width<T, std::enable_if_t<_format_plan<T>::fixed_shape>> {
+        static constexpr bool bounded = _format_plan<T>::bounded;
+        static constexpr std::size_t value = _format_plan<T>::max_size;
+    };
+
+    // Literal fragments around N fields, e.g. {"{", ", ", "}"} or {"{a: ", ", b: ", "}"},
+    // laid out at compile time in one static char array.
+    template <std::size_t N, class Names>
+    struct _plan_literals {
+        static constexpr std::string_view _piece(std::size_t i, std::size_t part) {
+            if (part == 0) return i == 0 ? "{" : i < N ? ", " : "";
+            if (part == 1) return i < N ? Names::name(i) : "";
+            if (part == 2) return i < N && !Names::name(i).empty() ? ": " : "";
+            return i == N ? "}" : "";
+        }
+
+        static constexpr std::size_t _length() {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i <= N; ++i)
+                for (std::size_t part = 0; part < 4; ++part) n += _piece(i, part).size();
+            return n;
+        }
+
+        struct _layout {
+            std::array<char, _length() + 1> chars{};
+            std::array<std::size_t, N + 2> offsets{};
+        };
+
+        static constexpr _layout _build() {
+            _layout l{};
+            std::size_t pos = 0;
+            for (std::size_t i = 0; i <= N; ++i) {
+                l.offsets[i] = pos;
+                for (std::size_t part = 0; part < 4; ++part) {
+                    std::string_view sv = _piece(i, part);
+                    for (std::size_t k = 0; k < sv.size(); ++k) l.chars[pos++] = sv[k];
+                }
+            }
+            l.offsets[N + 1] = pos;
+            return l;
+        }
+
+        static constexpr _layout layout = _build();
+
+        static constexpr std::string_view fragment(std::size_t i) {
+            return {layout.chars.data() + layout.offsets[i], layout.offsets[i + 1] - layout.offsets[i]};
+        }
+    };
+
+    struct _no_names {
+        static constexpr std::string_view name(std::size_t) {
+            return {};
+        }
+    };
+
+    template <class T, class = void>
+    struct _names_of : _no_names {
+    };
+
+    template <class T>
+    struct _names_of<T, std::void_t<decltype(T::print_names)>> {
+        static constexpr std::string_view name(std::size_t i) {
+            return T::print_names[i];
+        }
+    };
+
+    template <class Fields, class Names, class Is = std::make_index_sequence<std::tuple_size_v<Fields>>>
+    struct _plan_for;
+
+    template <class Fields, class Names, std::size_t ...Is>
+    struct _plan_for<Fields, Names, std::index_sequence<Is...>> : _plan_literals<sizeof...(Is), Names> {
+        static constexpr bool fixed_shape = true;
+        static constexpr std::size_t size = sizeof...(Is);
+        static constexpr bool bounded = (_max_width<_rmcvref_t<std::tuple_element_t<Is, Fields>>>::bounded && ...);
+        static constexpr std::size_t max_size = _plan_literals<sizeof...(Is), Names>::layout.offsets[sizeof...(Is) + 1] + (std::size_t(0) + ... + _max_width<_rmcvref_t<std::tuple_element_t<Is, Fields>>>::value);
+    };
+
+    // Fixed-shape types: tuples/pairs, small std::arrays and print_fields() structs.
+    template <class T>
+    struct _format_plan<T, typename _enable_if_tuple<T, std::enable_if_t<!_is_std_array<T>::value || (std::tuple_size<T>::value <= 64)>>::type> : _plan_for<T, _no_names> {
+    };
+
+    template <class T>
+    struct _format_plan<T, typename _enable_if_has_fields<T>::type> : _plan_for<decltype(std::declval<T const &>().print_fields()), _names_of<T>> {
+    };
+
+    // Emits fragment, field, fragment, ..., fragment; when every field has a
+    // bounded width the whole output is reserved up front.
+    template <class Plan, class Os, class Fields, std::size_t ...Is>
+    void _print_with_plan(Os &os, Fields const &fields, std::index_sequence<Is...>) {
+        if constexpr (!_is_ostream_v<Os> && Plan::bounded) os.reserve(Plan::max_size);
+        ((os << Plan::fragment(Is), _printer<_rmcvref_t<std::tuple_element_t<Is, Fields>>>::print(os, std::get<Is>(fields))), ...);
+        os << Plan::fragment(sizeof...(Is));
+    }
+
+    template <class T>
+    struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_has_fields<T>::type>::not_type> {
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            using Plan = _format_plan<T>;
+            _print_with_plan<Plan>(os, t.print_fields(), std::make_index_sequence<Plan::size>{});
+        }
+    };
+
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T>::type> {
-        static void print(std::ostream &os, T const &t) {
-            t.do_print(os);
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            if constexpr (_is_ostream_v<Os>) {
+                t.do_print(os);
+            } else {
+                _print_via_ostream(os, [&] (std::ostream &s) {
+                    t.do_print(s);
+                });
+            }
         }
     };
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_iterable<T, typename _enable_if_c_str<T, typename _enable_if_string<T, typename _enable_if_map<T>::not_type>::not_type>::not_type>::type>::not_type> {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            if constexpr (!_is_ostream_v<Os> && _format_plan<T>::fixed_shape) {
+                _print_with_plan<_format_plan<T>>(os, t, std::make_index_sequence<_format_plan<T>::size>{});
+                return;
+            }
             os << "{";
             bool once = false;
             for (auto const &v: t) {
@@ -176,22 +713,30 @@ namespace _print_details {
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_tuple<T, typename _enable_if_iterable<T>::not_type>::type>::not_type> {
-        template <std::size_t ...Is>
-        static void _unrolled_print(std::ostream &os, T const &t, std::index_sequence<Is...>) {
+        // Is... covers all but the last element, which is printed without a
+        // trailing separator (there is none for an empty tuple).
+        template <class Os, std::size_t ...Is>
+        static void _unrolled_print(Os &os, T const &t, std::index_sequence<Is...>) {
             os << "{";
             ((_printer<_rmcvref_t<std::tuple_element_t<Is, T>>>::print(os, std::get<Is>(t)), os << ", "), ...);
-            if constexpr (sizeof...(Is) != 0) _printer<_rmcvref_t<std::tuple_element_t<sizeof...(Is), T>>>::print(os, std::get<sizeof...(Is)>(t));
+            if constexpr (std::tuple_size_v<T> != 0) _printer<_rmcvref_t<std::tuple_element_t<sizeof...(Is), T>>>::print(os, std::get<sizeof...(Is)>(t));
             os << "}";
         }
 
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            if constexpr (!_is_ostream_v<Os>) {
+                _print_with_plan<_format_plan<T>>(os, t, std::make_index_sequence<std::tuple_size_v<T>>{});
+                return;
+            }
             _unrolled_print(os, t, std::make_index_sequence<std::max(static_cast<std::size_t>(1), std::tuple_size_v<T>) - 1>{});
         }
     };
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_map<T>::type>::not_type> {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
             os << "{";
             bool once = false;
             for (auto const &[k, v]: t) {
@@ -210,50 +755,78 @@ namespace _print_details {
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_string<T>::type>::not_type> {
-        static void print(std::ostream &os, T const &t) {
-            os << std::quoted(t);
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            if constexpr (!std::is_same_v<typename T::value_type, char>) {
+                os << std::quoted(t);
+            } else {
+                _append_quoted(os, t, '"');
+            }
         }
     };
 
     template <class T>
     struct _printer<T, typename _enable_if_c_str<T>::type> {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
             os << t;
         }
     };
 
     template <class T>
     struct _printer<T, typename _enable_if_char<T>::type> {
-        static void print(std::ostream &os, T const &t) {
-            T s[2] = {t, T('\0')};
-            os << std::quoted(s, T('\''));
+        template <class Os>
+        static void print(Os &os, T const &t) {
+            if constexpr (!std::is_same_v<T, char>) {
+                T s[2] = {t, T('\0')};
+                os << std::quoted(s, T('\''));
+            } else {
+                _append_quoted(os, std::string_view(&t, 1), '\'');
+            }
+        }
+    };
+
+    // Wrapper that prints a string as a JSON string literal.
+    struct json_quoted {
+        std::string_view str;
+    };
+
+    template <>
+    struct _printer<json_quoted, void> {
+        template <class Os>
+        static void print(Os &os, json_quoted const &t) {
+            _append_quoted(os, t.str, '"', true);
         }
     };
 
     template <>
     struct _printer<std::nullptr_t, void> {
-        static void print(std::ostream &os, std::nullptr_t const &) {
+        template <class Os>
+        static void print(Os &os, std::nullptr_t const &) {
             os << "nullptr";
         }
     };
 
     template <>
     struct _printer<std::nullopt_t, void> {
-        static void print(std::ostream &os, std::nullopt_t const &) {
+        template <class Os>
+        static void print(Os &os, std::nullopt_t const &) {
             os << "nullopt";
         }
     };
 
     template <>
     struct _printer<std::monostate, void> {
-        static void print(std::ostream &os, std::monostate const &) {
+        template <class Os>
+        static void print(Os &os, std::monostate const &) {
             os << "monostate";
         }
     };
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_optional<T>::type>::not_type> {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
             if (t.has_value()) {
                 _printer<typename T::value_type>::print(os, *t);
             } else {
@@ -264,7 +837,8 @@ namespace _print_details {
 
     template <class T>
     struct _printer<T, typename _enable_if_has_print<T, typename _enable_if_variant<T>::type>::not_type> {
-        static void print(std::ostream &os, T const &t) {
+        template <class Os>
+        static void print(Os &os, T const &t) {
             std::visit([&] (auto const &v) {
                 _printer<_rmcvref_t<decltype(v)>>::print(os, v);
             }, t);
@@ -273,7 +847,8 @@ namespace _print_details {
 
     template <>
     struct _printer<bool, void> {
-        static void print(std::ostream &os, bool const &t) {
+        template <class Os>
+        static void print(Os &os, bool const &t) {
             if (t) {
                 os << "true";
             } else {
@@ -282,44 +857,113 @@ namespace _print_details {
         }
     };
 
-    template <class T0, class ...Ts>
-    void fprint(std::ostream &os, T0 const &t0, Ts const &...ts) {
+    template <class Os, class T0, class ...Ts>
+    void fprint(Os &os, T0 const &t0, Ts const &...ts) {
         _printer<_rmcvref_t<T0>>::print(os, t0);
         ((os << " ", _printer<_rmcvref_t<Ts>>::print(os, ts)), ...);
         os << "\n";
     }
 
-    template <class T0, class ...Ts>
-    void fprintnl(std::ostream &os, T0 const &t0, Ts const &...ts) {
+    template <class Os, class T0, class ...Ts>
+    void fprintnl(Os &os, T0 const &t0, Ts const &...ts) {
         _printer<_rmcvref_t<T0>>::print(os, t0);
         ((os << " ", _printer<_rmcvref_t<Ts>>::print(os, ts)), ...);
     }
 
+    // Runs fn with this thread's reusable buffer (cleared); a nested call made
+    // from inside a user operator<< gets a fresh buffer instead.
+    template <class Fn>
+    void _with_thread_buffer(Fn &&fn) {
+        thread_local print_buffer buf;
+        thread_local bool busy = false;
+        if (busy) {
+            print_buffer local;
+            fn(local);
+            return;
+        }
+        struct _release {
+            bool &busy;
+            ~_release() {
+                busy = false;
+            }
+        } release{busy};
+        busy = true;
+        buf.clear();
+        fn(buf);
+    }
+
+    // print/eprint format into the thread buffer and hand the line to stdio in a
+    // single fwrite; this stays ordered with std::cout/std::cerr as long as
+    // std::ios_base::sync_with_stdio is left on.
     template <class T0, class ...Ts>
     void print(T0 const &t0, Ts const &...ts) {
-        fprint(std::cout, t0, ts...);
+        _with_thread_buffer([&] (print_buffer &buf) {
+            fprint(buf, t0, ts...);
+            buf.flush_to(stdout);
+        });
     }
 
     template <class T0, class ...Ts>
     void printnl(T0 const &t0, Ts const &...ts) {
-        fprintnl(std::cout, t0, ts...);
+        _with_thread_buffer([&] (print_buffer &buf) {
+            fprintnl(buf, t0, ts...);
+            buf.flush_to(stdout);
+        });
     }
 
     template <class T0, class ...Ts>
     void eprint(T0 const &t0, Ts const &...ts) {
-        fprint(std::cerr, t0, ts...);
+        _with_thread_buffer([&] (print_buffer &buf) {
+            fprint(buf, t0, ts...);
+            buf.flush_to(stderr);
+        });
     }
 
     template <class T0, class ...Ts>
     void eprintnl(T0 const &t0, Ts const &...ts) {
-        fprintnl(std::cerr, t0, ts...);
+        _with_thread_buffer([&] (print_buffer &buf) {
+            fprintnl(buf, t0, ts...);
+            buf.flush_to(stderr);
+        });
     }
 
+    // Exact length of what printnl(t0, ts...) would write, computed with the
+    // same printers as the real output.
+    template <class T0, class ...Ts>
+    std::size_t formatted_size(T0 const &t0, Ts const &...ts) {
+        _size_counter counter;
+        fprintnl(counter, t0, ts...);
+        return counter.size();
+    }
+
+    // Writes what printnl(t0, ts...) would into out[0, n) and returns the full
+    // length. Like snprintf, at most n - 1 characters are written followed by
+    // a NUL (nothing when n is 0), truncating output that does not fit.
+    template <class T0, class ...Ts>
+    std::size_t format_to(char *out, std::size_t n, T0 const &t0, Ts const &...ts) {
+        std::size_t size = formatted_size(t0, ts...);
+        if (n == 0) return size;
+        if (size < n) {
+            print_buffer buf(out, n);
+            fprintnl(buf, t0, ts...);
+            out[size] = '\0';
+        } else {
+            _with_thread_buffer([&] (print_buffer &buf) {
+                fprintnl(buf, t0, ts...);
+                std::memcpy(out, buf.data(), n - 1);
+            });
+            out[n - 1] = '\0';
+        }
+        return size;
+    }
+
+    // Sizes the result first so the string is allocated exactly once.
     template <class T0, class ...Ts>
     std::string to_string(T0 const &t0, Ts const &...ts) {
-        std::ostringstream oss;
-        fprint(oss, t0, ts...);
-        return oss.str();
+        std::string ret(formatted_size(t0, ts...) + 1, '\0');
+        print_buffer buf(ret.data(), ret.size());
+        fprint(buf, t0, ts...);
+        return ret;
     }
 
     template <class T, class = void>
@@ -364,10 +1008,26 @@ using _print_details::eprintnl;
 using _print_details::fprint;
 using _print_details::fprintnl;
 using _print_details::to_string;
+using _print_details::formatted_size;
+using _print_details::format_to;
 using _print_details::print_adaptor;
+using _print_details::print_buffer;
 using _print_details::is_printable;
+using _print_details::json_quoted;
 
 // Usage:
 //
 // map<string, optional<int>> m = {{"hello", 42}, {"world", nullopt}};
 // print(m);  // {"hello": 42, "world": nullopt}
+//
+// print_buffer out(stdout);  // or print_buffer(fd), or print_buffer(buf, sizeof(buf), stdout)
+// for (auto &x: xs) fprint(out, x);  // flushed in 64 KB chunks
+//
+// struct stat_t {
+//     int count; double mean;
+//     auto print_fields() const { return std::tie(count, mean); }
+//     static constexpr std::array<std::string_view, 2> print_names = {"count", "mean"};
+// };
+// print(stat_t{3, 1.5});  // {count: 3, mean: 1.5}
+//
+// print(json_quoted{"a\tb"});  // "a\tb", escaped as a JSON string literal
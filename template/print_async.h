@@ -0,0 +1,213 @@
+#pragma once
+// Asynchronous sink for print.h: callers format into their thread-local
+// print_buffer, copy the line into a slot of a bounded lock-free MPSC ring
+// and return; a background thread drains the ring and writes in large
+// batches. Lines from different threads never interleave mid-line.
+
+#include "print.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _print_details {
+    enum class overflow_policy {
+        block, // wait for the writer thread to free a slot
+        drop,  // discard the line and count it in dropped()
+    };
+
+    class async_sink {
+        // Slot of a Vyukov bounded queue: seq == pos means free for the
+        // producer of pos, seq == pos + 1 means filled and ready to consume.
+        struct alignas(64) _slot {
+            std::atomic<std::size_t> seq{0};
+            std::string data;
+        };
+
+        static constexpr std::size_t _max_kept_capacity = 4096;
+
+        std::vector<_slot> slots;
+        std::size_t mask;
+        overflow_policy policy;
+        int fd;
+        alignas(64) std::atomic<std::size_t> enqueue_pos{0};
+        alignas(64) std::atomic<std::size_t> written_pos{0};
+        std::atomic<std::uint64_t> dropped_count{0};
+        std::atomic<bool> sleeping{false};
+        std::atomic<bool> stopping{false};
+        std::mutex mtx;
+        std::condition_variable wake_writer;
+        std::condition_variable wake_waiters;
+        std::thread writer;
+
+        static std::size_t _round_up_pow2(std::size_t n) {
+            std::size_t p = 2;
+            while (p < n) p *= 2;
+            return p;
+        }
+
+        bool _try_push(std::string_view line) {
+            std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            while (true) {
+                _slot &s = slots[pos & mask];
+                std::size_t seq = s.seq.load(std::memory_order_acquire);
+                auto dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+                if (dif == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        s.data.assign(line.data(), line.size());
+                        s.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Dekker handshake with _run: each side stores (slot seq / sleeping),
+        // fences, then loads the other's flag, so at least one sees the other.
+        void _notify_writer() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(mtx);
+                wake_writer.notify_one();
+            }
+        }
+
+        void _push(std::string_view line) {
+            while (!_try_push(line)) {
+                if (policy == overflow_policy::drop) {
+                    dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                _notify_writer();
+                std::this_thread::yield();
+            }
+            _notify_writer();
+        }
+
+        void _run() {
+            print_buffer out(fd, 64 * 1024);
+            std::size_t pos = 0;
+            while (true) {
+                std::size_t begin = pos;
+                while (true) {
+                    _slot &s = slots[pos & mask];
+                    if (s.seq.load(std::memory_order_acquire) != pos + 1) break;
+                    out.append(s.data.data(), s.data.size());
+                    if (s.data.capacity() > _max_kept_capacity) std::string().swap(s.data);
+                    s.seq.store(pos + mask + 1, std::memory_order_release);
+                    ++pos;
+                }
+                if (pos != begin) {
+                    out.flush();
+                    written_pos.store(pos, std::memory_order_release);
+                    std::lock_guard<std::mutex> lock(mtx);
+                    wake_waiters.notify_all();
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire) && enqueue_pos.load(std::memory_order_acquire) == pos) {
+                    return;
+                }
+                std::unique_lock<std::mutex> lock(mtx);
+                sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (slots[pos & mask].seq.load(std::memory_order_acquire) != pos + 1 && !stopping.load(std::memory_order_acquire)) {
+                    wake_writer.wait_for(lock, std::chrono::milliseconds(10));
+                }
+                sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        explicit async_sink(int fd_ = 1, std::size_t capacity = 4096, overflow_policy policy_ = overflow_policy::block)
+            : slots(_round_up_pow2(capacity)), mask(slots.size() - 1), policy(policy_), fd(fd_) {
+            for (std::size_t i = 0; i < slots.size(); ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+            writer = std::thread([this] {
+                _run();
+            });
+        }
+
+        async_sink(async_sink const &) = delete;
+        async_sink &operator=(async_sink const &) = delete;
+
+        ~async_sink() {
+            stopping.store(true, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                wake_writer.notify_one();
+            }
+            writer.join();
+        }
+
+        // Blocks until every line enqueued before the call has been written.
+        void flush() {
+            std::size_t target = enqueue_pos.load(std::memory_order_acquire);
+            std::unique_lock<std::mutex> lock(mtx);
+            while (written_pos.load(std::memory_order_acquire) < target) {
+                wake_writer.notify_one();
+                wake_waiters.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+
+        std::uint64_t dropped() const {
+            return dropped_count.load(std::memory_order_relaxed);
+        }
+
+        template <class T0, class ...Ts>
+        void print(T0 const &t0, Ts const &...ts) {
+            _with_thread_buffer([&] (print_buffer &buf) {
+                fprint(buf, t0, ts...);
+                _push(buf.view());
+            });
+        }
+
+        template <class T0, class ...Ts>
+        void printnl(T0 const &t0, Ts const &...ts) {
+            _with_thread_buffer([&] (print_buffer &buf) {
+                fprintnl(buf, t0, ts...);
+                _push(buf.view());
+            });
+        }
+    };
+
+    // Process-wide sinks, flushed and joined at exit.
+    inline async_sink &async_stdout() {
+        static async_sink sink(1);
+        return sink;
+    }
+
+    inline async_sink &async_stderr() {
+        static async_sink sink(2);
+        return sink;
+    }
+
+    template <class T0, class ...Ts>
+    void aprint(T0 const &t0, Ts const &...ts) {
+        async_stdout().print(t0, ts...);
+    }
+
+    template <class T0, class ...Ts>
+    void aeprint(T0 const &t0, Ts const &...ts) {
+        async_stderr().print(t0, ts...);
+    }
+}
+
+using _print_details::async_sink;
+using _print_details::overflow_policy;
+using _print_details::async_stdout;
+using _print_details::async_stderr;
+using _print_details::aprint;
+using _print_details::aeprint;
+
+// Usage:
+//
+// aprint("latency", 42);      // returns once the line is queued
+// async_stdout().flush();     // wait until it reached fd 1
+//
+// async_sink log(fd, 1024, overflow_policy::drop);  // never blocks the caller
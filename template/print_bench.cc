@@ -0,0 +1,308 @@
+// Cost of print.h against hand-written printf, iostream and std::to_chars
+// baselines producing the same text, both to /dev/null and to memory.
+// Reports ns per element, with heap allocations per call in the row name.
+//
+// Run: build/print_bench [--reps=N] [--target_ms=X] [--json=PATH]
+// (stdout points at /dev/null while measuring and back at the real output
+// while a report row is printed)
+
+#include "../performance/bench.h"
+#include "print.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <variant>
+#include <vector>
+
+static std::size_t g_allocs = 0;
+
+void *operator new(std::size_t n) {
+  ++g_allocs;
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+// Out of line: once free() is inlined into a caller of the replaced
+// operator new, GCC reports a false -Wmismatched-new-delete.
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+using Map = std::map<std::string, std::optional<int>>;
+using Var = std::variant<int, double, std::string>;
+
+static int g_out_fd = -1, g_null_fd = -1;
+static char g_scratch[1 << 20];
+
+// Runs fn (which prints part of the report) with stdout on the real output.
+template <class Fn> void report(Fn fn) {
+  std::cout.flush();
+  std::fflush(stdout);
+  dup2(g_out_fd, STDOUT_FILENO);
+  fn();
+  std::cout.flush();
+  std::fflush(stdout);
+  dup2(g_null_fd, STDOUT_FILENO);
+}
+
+template <class Fn>
+void measure(const char *method, std::size_t elements, Fn fn) {
+  fn();
+  std::size_t before = g_allocs;
+  for (int i = 0; i < 100; ++i)
+    fn();
+  double allocs = (g_allocs - before) / 100.0;
+  char name[96];
+  std::snprintf(name, sizeof(name), "%s, %.2f allocs/call", method, allocs);
+  auto r = bench::run(name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      fn();
+  });
+  bench::scale(r, elements);
+  report([&] { bench::printRow(r); });
+}
+
+// Baselines: the same output as print.h, written by hand.
+
+static char *chars(char *p, int v) {
+  return std::to_chars(p, p + 16, v).ptr;
+}
+
+static char *chars(char *p, double v) {
+  return std::to_chars(p, p + 32, v, std::chars_format::general, 6).ptr;
+}
+
+static char *quoted(char *p, std::string const &s) {
+  *p++ = '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      *p++ = '\\';
+    *p++ = c;
+  }
+  *p++ = '"';
+  return p;
+}
+
+static char *chars(char *p, std::string const &s) { return quoted(p, s); }
+
+static char *chars(char *p, Map const &m) {
+  *p++ = '{';
+  bool once = false;
+  for (auto const &[k, v] : m) {
+    if (once) {
+      *p++ = ',';
+      *p++ = ' ';
+    }
+    once = true;
+    p = quoted(p, k);
+    *p++ = ':';
+    *p++ = ' ';
+    if (v) {
+      p = chars(p, *v);
+    } else {
+      std::memcpy(p, "nullopt", 7);
+      p += 7;
+    }
+  }
+  *p++ = '}';
+  return p;
+}
+
+static char *chars(char *p, Var const &v) {
+  return std::visit(
+      [&](auto const &x) {
+        if constexpr (std::is_same_v<decltype(x), std::string const &>)
+          return quoted(p, x);
+        else
+          return chars(p, x);
+      },
+      v);
+}
+
+template <class T> static char *chars(char *p, std::vector<T> const &v) {
+  *p++ = '{';
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i) {
+      *p++ = ',';
+      *p++ = ' ';
+    }
+    p = chars(p, v[i]);
+  }
+  *p++ = '}';
+  return p;
+}
+
+static void printf_value(FILE *f, int v) { std::fprintf(f, "%d", v); }
+static void printf_value(FILE *f, double v) { std::fprintf(f, "%g", v); }
+
+static void printf_value(FILE *f, std::string const &s) {
+  std::fputc('"', f);
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      std::fputc('\\', f);
+    std::fputc(c, f);
+  }
+  std::fputc('"', f);
+}
+
+static void printf_value(FILE *f, Map const &m) {
+  std::fputc('{', f);
+  bool once = false;
+  for (auto const &[k, v] : m) {
+    std::fputs(once ? ", " : "", f);
+    once = true;
+    printf_value(f, k);
+    if (v)
+      std::fprintf(f, ": %d", *v);
+    else
+      std::fputs(": nullopt", f);
+  }
+  std::fputc('}', f);
+}
+
+static void printf_value(FILE *f, Var const &v) {
+  std::visit([&](auto const &x) { printf_value(f, x); }, v);
+}
+
+template <class T>
+static void printf_value(FILE *f, std::vector<T> const &v) {
+  std::fputc('{', f);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      std::fputs(", ", f);
+    printf_value(f, v[i]);
+  }
+  std::fputc('}', f);
+}
+
+static void stream_value(std::ostream &os, int v) { os << v; }
+static void stream_value(std::ostream &os, double v) { os << v; }
+
+static void stream_value(std::ostream &os, std::string const &s) {
+  os << std::quoted(s);
+}
+
+static void stream_value(std::ostream &os, Map const &m) {
+  os << '{';
+  bool once = false;
+  for (auto const &[k, v] : m) {
+    os << (once ? ", " : "") << std::quoted(k) << ": ";
+    once = true;
+    if (v)
+      os << *v;
+    else
+      os << "nullopt";
+  }
+  os << '}';
+}
+
+static void stream_value(std::ostream &os, Var const &v) {
+  std::visit([&](auto const &x) { stream_value(os, x); }, v);
+}
+
+template <class T>
+static void stream_value(std::ostream &os, std::vector<T> const &v) {
+  os << '{';
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      os << ", ";
+    stream_value(os, v[i]);
+  }
+  os << '}';
+}
+
+template <class T>
+void run_case(const char *type, std::size_t elements, T const &value) {
+  FILE *null_file = stdout;
+  print_buffer mem;
+  std::string expected(g_scratch, chars(g_scratch, value));
+  if (expected + "\n" != to_string(value))
+    std::fprintf(stderr, "%s: baseline output differs from print.h\n", type);
+  report([&] {
+    bench::printHeader(std::string(type) + ", ns/element");
+  });
+
+  // /dev/null
+  measure("print", elements, [&] { print(value); });
+  measure("printf", elements, [&] {
+    printf_value(null_file, value);
+    std::fputc('\n', null_file);
+  });
+  measure("iostream", elements, [&] {
+    stream_value(std::cout, value);
+    std::cout << '\n';
+  });
+  measure("to_chars + fwrite", elements, [&] {
+    char *end = chars(g_scratch, value);
+    *end++ = '\n';
+    std::fwrite(g_scratch, 1, end - g_scratch, null_file);
+  });
+
+  // memory
+  measure("to_string", elements,
+          [&] { doNotOptimizeAway(to_string(value)); });
+  measure("fprint(print_buffer)", elements, [&] {
+    mem.clear();
+    fprint(mem, value);
+    doNotOptimizeAway(mem.data());
+  });
+  measure("fprintf(fmemopen)", elements, [&] {
+    FILE *f = fmemopen(g_scratch, sizeof(g_scratch), "w");
+    printf_value(f, value);
+    std::fputc('\n', f);
+    std::fclose(f);
+  });
+  measure("ostringstream", elements, [&] {
+    std::ostringstream os;
+    stream_value(os, value);
+    os << '\n';
+    doNotOptimizeAway(os.str());
+  });
+  measure("to_chars", elements, [&] {
+    char *end = chars(g_scratch, value);
+    doNotOptimizeAway(end);
+  });
+}
+
+int main(int argc, char *argv[]) {
+  bench::parseArgs(argc, argv);
+  g_out_fd = dup(STDOUT_FILENO);
+  g_null_fd = open("/dev/null", O_WRONLY);
+  dup2(g_null_fd, STDOUT_FILENO);
+  std::ios::sync_with_stdio(false);
+
+  std::string str = "a \"quoted\" string of 32 chars..";
+  Map map;
+  for (int i = 0; i < 100; ++i)
+    map["key" + std::to_string(i)] =
+        i % 3 ? std::optional<int>(i * 37) : std::nullopt;
+  std::vector<Var> vars;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3 == 0)
+      vars.emplace_back(i);
+    else if (i % 3 == 1)
+      vars.emplace_back(i * 0.37);
+    else
+      vars.emplace_back("s" + std::to_string(i));
+  }
+  std::vector<int> ints(10000);
+  for (int i = 0; i < 10000; ++i)
+    ints[i] = i * 7919 - 5000000;
+
+  run_case("int", 1, 123456);
+  run_case("double", 1, 3.14159);
+  run_case("string", 1, str);
+  run_case("map<str,opt>", map.size(), map);
+  run_case("vector<var>", vars.size(), vars);
+  run_case("vector<int>", ints.size(), ints);
+  return 0;
+}
@@ -0,0 +1,296 @@
+#pragma once
+// Deferred formatting for print.h: tprint(args...) stores the raw arguments
+// as a binary record in a per-thread ring and returns. Text is produced later
+// by trace_drain() or a trace_reader thread, through the same _printer
+// specializations print() uses, so the output is identical.
+//
+// Record layout (8-byte aligned): uint32 size, uint32 signature id, payload.
+// The signature id names the argument type list; its decoder is registered on
+// first use. Strings are copied (length + bytes); any other argument must be
+// trivially copy-constructible (pair, optional, array of PODs...) and is
+// stored as its object representation. Such an argument must not refer to
+// memory it does not own: the record is formatted after tprint returns, when
+// the pointee may be gone. Pointers (other than C strings) are rejected; a
+// pointer or view inside an aggregate cannot be detected, so do not pass one.
+// Records are decoded in the process that wrote them.
+
+#include "print.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace _print_details {
+    using _trace_decoder = void (*)(print_buffer &, char const *);
+
+    struct _trace_header {
+        std::uint32_t size;
+        std::uint32_t id; // 0: padding up to the end of the ring
+    };
+
+    inline constexpr std::size_t _trace_max_signatures = 4096;
+    inline constexpr std::size_t _trace_ring_capacity = 1 << 20;
+
+    inline std::atomic<_trace_decoder> _trace_decoders[_trace_max_signatures];
+    inline std::atomic<std::uint32_t> _trace_next_id{1};
+
+    inline std::uint32_t _trace_register(_trace_decoder decode) {
+        std::uint32_t id = _trace_next_id.fetch_add(1, std::memory_order_relaxed);
+        if (id >= _trace_max_signatures) return 0;
+        _trace_decoders[id].store(decode, std::memory_order_release);
+        return id;
+    }
+
+    template <class T>
+    struct _trace_codec {
+        static constexpr bool is_c_str = std::is_pointer_v<std::decay_t<T>> && std::is_same_v<std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>, char>;
+        static constexpr bool is_string = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+        static constexpr bool is_raw = std::is_trivially_copy_constructible_v<T> && std::is_trivially_destructible_v<T> &&
+                                       !std::is_pointer_v<std::decay_t<T>> && !std::is_member_pointer_v<T>;
+        static_assert(is_c_str || is_string || is_raw,
+                      "tprint arguments must be strings or trivially copyable values that own their data");
+
+        static std::string_view _text(T const &t) {
+            if constexpr (std::is_pointer_v<T>) {
+                return t ? std::string_view(t) : std::string_view();
+            } else {
+                return t;
+            }
+        }
+
+        static std::size_t size(T const &t) {
+            if constexpr (is_c_str || is_string) {
+                return sizeof(std::uint32_t) + _text(t).size();
+            } else {
+                return sizeof(T);
+            }
+        }
+
+        static char *encode(char *p, T const &t) {
+            if constexpr (is_c_str || is_string) {
+                std::string_view s = _text(t);
+                auto n = static_cast<std::uint32_t>(s.size());
+                std::memcpy(p, &n, sizeof(n));
+                std::memcpy(p + sizeof(n), s.data(), n);
+                return p + sizeof(n) + n;
+            } else {
+                std::memcpy(p, &t, sizeof(T));
+                return p + sizeof(T);
+            }
+        }
+
+        static char const *decode(print_buffer &out, char const *p) {
+            if constexpr (is_c_str || is_string) {
+                std::uint32_t n;
+                std::memcpy(&n, p, sizeof(n));
+                std::string_view s(p + sizeof(n), n);
+                if constexpr (is_c_str) {
+                    out << s;
+                } else {
+                    _printer<std::string_view>::print(out, s);
+                }
+                return p + sizeof(n) + n;
+            } else {
+                alignas(T) unsigned char storage[sizeof(T)];
+                std::memcpy(storage, p, sizeof(T));
+                _printer<T>::print(out, *std::launder(reinterpret_cast<T const *>(storage)));
+                return p + sizeof(T);
+            }
+        }
+    };
+
+    template <class ...Ts>
+    struct _trace_signature {
+        static void decode(print_buffer &out, char const *p) {
+            bool first = true;
+            ((first ? void(first = false) : void(out << " "), p = _trace_codec<Ts>::decode(out, p)), ...);
+            out << "\n";
+        }
+
+        static std::uint32_t id() {
+            static std::uint32_t const value = _trace_register(&decode);
+            return value;
+        }
+    };
+
+    // Single-producer (owning thread) / single-consumer (reader) byte ring.
+    struct _trace_ring {
+        std::unique_ptr<std::uint64_t[]> storage{new std::uint64_t[_trace_ring_capacity / 8]};
+        char *data = reinterpret_cast<char *>(storage.get());
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        std::uint64_t cached_tail = 0;
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> orphaned{false};
+
+        // Reserves a record of n bytes (multiple of 8); nullptr if the ring is full.
+        char *prepare(std::size_t n) {
+            constexpr std::size_t cap = _trace_ring_capacity;
+            std::uint64_t h = head.load(std::memory_order_relaxed);
+            std::size_t to_end = cap - (h & (cap - 1));
+            std::size_t total = n <= to_end ? n : to_end + n;
+            if (total > cap - (h - cached_tail)) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (total > cap - (h - cached_tail)) return nullptr;
+            }
+            if (n > to_end) {
+                _trace_header pad{static_cast<std::uint32_t>(to_end), 0};
+                std::memcpy(data + (h & (cap - 1)), &pad, sizeof(pad));
+                head.store(h + to_end, std::memory_order_release);
+                h += to_end;
+            }
+            return data + (h & (cap - 1));
+        }
+
+        void commit(std::size_t n) {
+            head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        }
+
+        std::size_t drain(print_buffer &out) {
+            std::size_t count = 0;
+            std::uint64_t t = tail.load(std::memory_order_relaxed);
+            std::uint64_t h = head.load(std::memory_order_acquire);
+            while (t != h) {
+                _trace_header hdr;
+                std::memcpy(&hdr, data + (t & (_trace_ring_capacity - 1)), sizeof(hdr));
+                if (hdr.id != 0) {
+                    _trace_decoders[hdr.id].load(std::memory_order_acquire)(out, data + (t & (_trace_ring_capacity - 1)) + sizeof(hdr));
+                    ++count;
+                }
+                t += hdr.size;
+            }
+            tail.store(t, std::memory_order_release);
+            return count;
+        }
+    };
+
+    struct _trace_registry {
+        std::mutex mtx;
+        std::vector<std::shared_ptr<_trace_ring>> rings;
+        std::atomic<std::uint64_t> retired_dropped{0};
+
+        static _trace_registry &get() {
+            static _trace_registry instance;
+            return instance;
+        }
+    };
+
+    inline _trace_ring &_trace_local_ring() {
+        struct _owner {
+            std::shared_ptr<_trace_ring> ring = std::make_shared<_trace_ring>();
+
+            _owner() {
+                _trace_registry &reg = _trace_registry::get();
+                std::lock_guard<std::mutex> lock(reg.mtx);
+                reg.rings.push_back(ring);
+            }
+
+            ~_owner() {
+                ring->orphaned.store(true, std::memory_order_release);
+            }
+        };
+        thread_local _owner owner;
+        return *owner.ring;
+    }
+
+    // Records the arguments; never blocks, drops the record if the thread's ring is full.
+    template <class T0, class ...Ts>
+    void tprint(T0 const &t0, Ts const &...ts) {
+        using sig = _trace_signature<_rmcvref_t<T0>, _rmcvref_t<Ts>...>;
+        _trace_ring &ring = _trace_local_ring();
+        std::uint32_t id = sig::id();
+        std::size_t payload = _trace_codec<_rmcvref_t<T0>>::size(t0) + (_trace_codec<_rmcvref_t<Ts>>::size(ts) + ... + 0);
+        std::size_t n = (sizeof(_trace_header) + payload + 7) & ~std::size_t(7);
+        char *p = id && n <= _trace_ring_capacity / 2 ? ring.prepare(n) : nullptr;
+        if (!p) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        _trace_header hdr{static_cast<std::uint32_t>(n), id};
+        std::memcpy(p, &hdr, sizeof(hdr));
+        char *q = _trace_codec<_rmcvref_t<T0>>::encode(p + sizeof(hdr), t0);
+        ((q = _trace_codec<_rmcvref_t<Ts>>::encode(q, ts)), ...);
+        ring.commit(n);
+    }
+
+    // Formats every pending record into out, thread by thread in record order;
+    // returns the number of records. Call from one reader at a time.
+    inline std::size_t trace_drain(print_buffer &out) {
+        _trace_registry &reg = _trace_registry::get();
+        std::vector<std::shared_ptr<_trace_ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(reg.mtx);
+            rings = reg.rings;
+        }
+        std::size_t count = 0;
+        for (auto &ring: rings) {
+            bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+            count += ring->drain(out);
+            if (orphaned) {
+                std::lock_guard<std::mutex> lock(reg.mtx);
+                reg.retired_dropped.fetch_add(ring->dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                reg.rings.erase(std::find(reg.rings.begin(), reg.rings.end(), ring));
+            }
+        }
+        return count;
+    }
+
+    inline std::uint64_t trace_dropped() {
+        _trace_registry &reg = _trace_registry::get();
+        std::lock_guard<std::mutex> lock(reg.mtx);
+        std::uint64_t n = reg.retired_dropped.load(std::memory_order_relaxed);
+        for (auto &ring: reg.rings) n += ring->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // Background thread that periodically drains all trace rings to a FILE *.
+    class trace_reader {
+        std::FILE *fp;
+        std::chrono::milliseconds period;
+        std::atomic<bool> stopping{false};
+        std::thread thr;
+
+        void _drain_once(print_buffer &out) {
+            trace_drain(out);
+            out.flush();
+            std::fflush(fp);
+        }
+
+    public:
+        explicit trace_reader(std::FILE *fp_ = stdout, std::chrono::milliseconds period_ = std::chrono::milliseconds(10))
+            : fp(fp_), period(period_) {
+            thr = std::thread([this] {
+                print_buffer out(fp);
+                while (!stopping.load(std::memory_order_acquire)) {
+                    _drain_once(out);
+                    std::this_thread::sleep_for(period);
+                }
+                _drain_once(out);
+            });
+        }
+
+        trace_reader(trace_reader const &) = delete;
+        trace_reader &operator=(trace_reader const &) = delete;
+
+        ~trace_reader() {
+            stopping.store(true, std::memory_order_release);
+            thr.join();
+        }
+    };
+}
+
+using _print_details::tprint;
+using _print_details::trace_drain;
+using _print_details::trace_dropped;
+using _print_details::trace_reader;
+
+// Usage:
+//
+// trace_reader reader(stderr);        // formats in the background
+// tprint("recv id", id, "latency", us); // ~tens of ns: no formatting on the caller
+//
+// print_buffer out;                   // or drain on demand, e.g. at shutdown
+// trace_drain(out);
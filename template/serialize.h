@@ -0,0 +1,486 @@
+#pragma once
+// Structured output for the types print.h understands: strict JSON and a
+// compact MessagePack encoding. Type detection reuses print.h's _enable_if_*
+// traits, so anything print() accepts can be serialized; types without a
+// structural mapping (do_print, operator<< only) become their printed text.
+// Writers stream straight into a print_buffer (memory, FILE * or fd).
+
+#include "print.h"
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+
+namespace _print_details {
+    template <class T, class = void>
+    struct _has_size : std::false_type {
+    };
+
+    template <class T>
+    struct _has_size<T, std::void_t<decltype(std::size(std::declval<T const &>()))>> : std::true_type {
+    };
+
+    template <class T>
+    std::size_t _element_count(T const &t) {
+        if constexpr (_has_size<T>::value) {
+            return static_cast<std::size_t>(std::size(t));
+        } else {
+            return static_cast<std::size_t>(std::distance(std::begin(t), std::end(t)));
+        }
+    }
+
+    template <class T, class = void>
+    struct _serializer {
+        template <class W>
+        static void write(W &w, T const &t) {
+            if constexpr (std::is_same_v<T, char>) {
+                w.string(std::string_view(&t, 1));
+            } else if constexpr (std::is_integral_v<T>) {
+                w.integer(t);
+            } else if constexpr (std::is_same_v<T, float>) {
+                w.number(t);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                w.number(static_cast<double>(t));
+            } else if constexpr (std::is_enum_v<T>) {
+                w.integer(static_cast<std::underlying_type_t<T>>(t));
+            } else {
+                w.text(t);
+            }
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_has_fields<T>::type>::not_type> {
+        template <class W, class Fields, std::size_t ...Is>
+        static void _write_fields(W &w, Fields const &fields, std::index_sequence<Is...>) {
+            constexpr bool named = !std::is_base_of_v<_no_names, _names_of<T>>;
+            if constexpr (named) {
+                w.begin_object(sizeof...(Is));
+                ((Is ? w.separator() : void(), w.key(_names_of<T>::name(Is)), w.value(std::get<Is>(fields))), ...);
+                w.end_object();
+            } else {
+                w.begin_array(sizeof...(Is));
+                ((Is ? w.separator() : void(), w.value(std::get<Is>(fields))), ...);
+                w.end_array();
+            }
+        }
+
+        template <class W>
+        static void write(W &w, T const &t) {
+            auto const &fields = t.print_fields();
+            _write_fields(w, fields, std::make_index_sequence<std::tuple_size_v<_rmcvref_t<decltype(fields)>>>{});
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T>::type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            w.text(t);
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_iterable<T, typename _enable_if_c_str<T, typename _enable_if_string<T, typename _enable_if_map<T>::not_type>::not_type>::not_type>::type>::not_type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            w.begin_array(_element_count(t));
+            bool once = false;
+            for (auto const &v: t) {
+                if (once) {
+                    w.separator();
+                } else {
+                    once = true;
+                }
+                w.value(v);
+            }
+            w.end_array();
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_tuple<T, typename _enable_if_iterable<T>::not_type>::type>::not_type> {
+        template <class W, std::size_t ...Is>
+        static void _write_elements(W &w, T const &t, std::index_sequence<Is...>) {
+            ((Is ? w.separator() : void(), w.value(std::get<Is>(t))), ...);
+        }
+
+        template <class W>
+        static void write(W &w, T const &t) {
+            w.begin_array(std::tuple_size_v<T>);
+            _write_elements(w, t, std::make_index_sequence<std::tuple_size_v<T>>{});
+            w.end_array();
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_map<T>::type>::not_type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            w.begin_object(t.size());
+            bool once = false;
+            for (auto const &[k, v]: t) {
+                if (once) {
+                    w.separator();
+                } else {
+                    once = true;
+                }
+                w.key(k);
+                w.value(v);
+            }
+            w.end_object();
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_string<T>::type>::not_type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            if constexpr (std::is_same_v<typename T::value_type, char>) {
+                w.string(t);
+            } else {
+                w.text(t);
+            }
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_c_str<T>::type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            if constexpr (std::is_same_v<std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>, char>) {
+                if (t) {
+                    w.string(t);
+                } else {
+                    w.null();
+                }
+            } else {
+                w.text(t);
+            }
+        }
+    };
+
+    template <>
+    struct _serializer<bool, void> {
+        template <class W>
+        static void write(W &w, bool const &t) {
+            w.boolean(t);
+        }
+    };
+
+    template <>
+    struct _serializer<std::nullptr_t, void> {
+        template <class W>
+        static void write(W &w, std::nullptr_t const &) {
+            w.null();
+        }
+    };
+
+    template <>
+    struct _serializer<std::nullopt_t, void> {
+        template <class W>
+        static void write(W &w, std::nullopt_t const &) {
+            w.null();
+        }
+    };
+
+    template <>
+    struct _serializer<std::monostate, void> {
+        template <class W>
+        static void write(W &w, std::monostate const &) {
+            w.null();
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_optional<T>::type>::not_type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            if (t.has_value()) {
+                w.value(*t);
+            } else {
+                w.null();
+            }
+        }
+    };
+
+    template <class T>
+    struct _serializer<T, typename _enable_if_has_print<T, typename _enable_if_variant<T>::type>::not_type> {
+        template <class W>
+        static void write(W &w, T const &t) {
+            std::visit([&] (auto const &v) {
+                w.value(v);
+            }, t);
+        }
+    };
+
+    // Shared by both writers: formats t with print.h and emits it as a string.
+    template <class W, class T>
+    void _write_printed(W &w, T const &t) {
+        char tmp[256];
+        print_buffer buf(tmp, sizeof(tmp));
+        _printer<T>::print(buf, t);
+        w.string(buf.view());
+    }
+
+    // Strict JSON (RFC 8259): no whitespace, strings escaped, non-finite
+    // numbers as null, non-string map keys converted to their printed text.
+    template <class Sink>
+    class json_writer {
+        Sink &out;
+
+    public:
+        explicit json_writer(Sink &out_) : out(out_) {
+        }
+
+        void null() {
+            out.append("null", 4);
+        }
+
+        void boolean(bool b) {
+            if (b) {
+                out.append("true", 4);
+            } else {
+                out.append("false", 5);
+            }
+        }
+
+        template <class I>
+        void integer(I v) {
+            char tmp[24];
+            if constexpr (std::is_signed_v<I>) {
+                auto r = std::to_chars(tmp, tmp + sizeof(tmp), static_cast<long long>(v));
+                out.append(tmp, static_cast<std::size_t>(r.ptr - tmp));
+            } else {
+                auto r = std::to_chars(tmp, tmp + sizeof(tmp), static_cast<unsigned long long>(v));
+                out.append(tmp, static_cast<std::size_t>(r.ptr - tmp));
+            }
+        }
+
+        // Shortest representation that round-trips in the value's own type,
+        // so 0.1f prints as 0.1 rather than 0.10000000149011612.
+        template <class F>
+        void number(F v) {
+            if (!std::isfinite(v)) {
+                null();
+                return;
+            }
+            char tmp[32];
+            auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+            out.append(tmp, static_cast<std::size_t>(r.ptr - tmp));
+        }
+
+        void string(std::string_view s) {
+            _append_quoted(out, s, '"', true);
+        }
+
+        template <class T>
+        void text(T const &t) {
+            _write_printed(*this, t);
+        }
+
+        void begin_array(std::size_t) {
+            out.put('[');
+        }
+
+        void end_array() {
+            out.put(']');
+        }
+
+        void begin_object(std::size_t) {
+            out.put('{');
+        }
+
+        void end_object() {
+            out.put('}');
+        }
+
+        void separator() {
+            out.put(',');
+        }
+
+        template <class K>
+        void key(K const &k) {
+            if constexpr (std::is_convertible_v<K const &, std::string_view>) {
+                string(k);
+            } else {
+                _write_printed(*this, k);
+            }
+            out.put(':');
+        }
+
+        template <class T>
+        void value(T const &t) {
+            _serializer<_rmcvref_t<T>>::write(*this, t);
+        }
+    };
+
+    // MessagePack: smallest encoding for every integer, float32 for float,
+    // float64 for other floating types, str/array/map headers sized to their
+    // element counts.
+    template <class Sink>
+    class msgpack_writer {
+        Sink &out;
+
+        void _tagged(std::uint8_t tag, std::uint64_t v, int bytes) {
+            char tmp[9];
+            tmp[0] = static_cast<char>(tag);
+            for (int i = 0; i < bytes; ++i) tmp[1 + i] = static_cast<char>(v >> (8 * (bytes - 1 - i)));
+            out.append(tmp, static_cast<std::size_t>(1 + bytes));
+        }
+
+        void _header(std::size_t n, std::uint8_t fix, std::size_t fix_max, std::uint8_t tag8, std::uint8_t tag16, std::uint8_t tag32) {
+            if (n <= fix_max) {
+                out.put(static_cast<char>(fix | n));
+            } else if (tag8 && n <= 0xff) {
+                _tagged(tag8, n, 1);
+            } else if (n <= 0xffff) {
+                _tagged(tag16, n, 2);
+            } else {
+                _tagged(tag32, n, 4);
+            }
+        }
+
+    public:
+        explicit msgpack_writer(Sink &out_) : out(out_) {
+        }
+
+        void null() {
+            out.put(static_cast<char>(0xc0));
+        }
+
+        void boolean(bool b) {
+            out.put(static_cast<char>(b ? 0xc3 : 0xc2));
+        }
+
+        template <class I>
+        void integer(I v) {
+            if constexpr (std::is_signed_v<I>) {
+                if (v < 0) {
+                    auto s = static_cast<std::int64_t>(v);
+                    if (s >= -32) {
+                        out.put(static_cast<char>(s));
+                    } else if (s >= INT8_MIN) {
+                        _tagged(0xd0, static_cast<std::uint64_t>(s), 1);
+                    } else if (s >= INT16_MIN) {
+                        _tagged(0xd1, static_cast<std::uint64_t>(s), 2);
+                    } else if (s >= INT32_MIN) {
+                        _tagged(0xd2, static_cast<std::uint64_t>(s), 4);
+                    } else {
+                        _tagged(0xd3, static_cast<std::uint64_t>(s), 8);
+                    }
+                    return;
+                }
+            }
+            auto u = static_cast<std::uint64_t>(v);
+            if (u < 0x80) {
+                out.put(static_cast<char>(u));
+            } else if (u <= 0xff) {
+                _tagged(0xcc, u, 1);
+            } else if (u <= 0xffff) {
+                _tagged(0xcd, u, 2);
+            } else if (u <= 0xffffffff) {
+                _tagged(0xce, u, 4);
+            } else {
+                _tagged(0xcf, u, 8);
+            }
+        }
+
+        void number(float v) {
+            std::uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            _tagged(0xca, bits, 4);
+        }
+
+        void number(double v) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            _tagged(0xcb, bits, 8);
+        }
+
+        void string(std::string_view s) {
+            _header(s.size(), 0xa0, 31, 0xd9, 0xda, 0xdb);
+            out.append(s.data(), s.size());
+        }
+
+        template <class T>
+        void text(T const &t) {
+            _write_printed(*this, t);
+        }
+
+        void begin_array(std::size_t n) {
+            _header(n, 0x90, 15, 0, 0xdc, 0xdd);
+        }
+
+        void end_array() {
+        }
+
+        void begin_object(std::size_t n) {
+            _header(n, 0x80, 15, 0, 0xde, 0xdf);
+        }
+
+        void end_object() {
+        }
+
+        void separator() {
+        }
+
+        template <class K>
+        void key(K const &k) {
+            value(k);
+        }
+
+        template <class T>
+        void value(T const &t) {
+            _serializer<_rmcvref_t<T>>::write(*this, t);
+        }
+    };
+
+    template <class Sink, class T>
+    void write_json(Sink &out, T const &t) {
+        json_writer<Sink> w(out);
+        w.value(t);
+    }
+
+    template <class Sink, class T>
+    void write_msgpack(Sink &out, T const &t) {
+        msgpack_writer<Sink> w(out);
+        w.value(t);
+    }
+
+    // Two passes like to_string: count the exact size, then fill the string in place.
+    template <template <class> class Writer, class T>
+    std::string _serialize_to_string(T const &t) {
+        _size_counter counter;
+        Writer<_size_counter>(counter).value(t);
+        std::string s(counter.size(), '\0');
+        print_buffer buf(s.data(), s.size());
+        Writer<print_buffer>(buf).value(t);
+        return s;
+    }
+
+    template <class T>
+    std::string to_json(T const &t) {
+        return _serialize_to_string<json_writer>(t);
+    }
+
+    template <class T>
+    std::string to_msgpack(T const &t) {
+        return _serialize_to_string<msgpack_writer>(t);
+    }
+}
+
+using _print_details::json_writer;
+using _print_details::msgpack_writer;
+using _print_details::write_json;
+using _print_details::write_msgpack;
+using _print_details::to_json;
+using _print_details::to_msgpack;
+
+// Usage:
+//
+// map<string, vector<int>> m = {{"a", {1, 2}}};
+// to_json(m);  // {"a":[1,2]}
+//
+// print_buffer out(stdout);  // streaming, no intermediate strings
+// json_writer w(out);
+// w.begin_object(1); w.key("rows"); w.value(rows); w.end_object();
@@ -1,4 +1,9 @@
+#include "../performance/bench.h"
+#include "append.h"
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <string>
 #include <type_traits>
 #include <vector>
 using namespace std;
@@ -132,11 +137,110 @@ void test_constexpr_append() {
   // std::cout << "append v.size " << v.size() << std::endl;
 }
 
-int main() {
+// Appending a container to itself: the source moves when the container grows.
+void test_bulk_append_self() {
+  std::string s(100, 'a');
+  s.back() = 'b';
+  bulk_append(s, s.data(), s.size());
+  std::cout << "bulk_append self: " << s.size() << " "
+            << (s == std::string(99, 'a') + 'b' + std::string(99, 'a') + 'b')
+            << std::endl;
+}
+
+// A contiguous buffer with resize() + data() but no range insert, the kind
+// of container bulk_append fills with a single memcpy (path 1 in append.h).
+template <typename T> class flat_buffer {
+  std::vector<T> v;
+
+public:
+  using value_type = T;
+  void reserve(size_t n) { v.reserve(n); }
+  void resize(size_t n) { v.resize(n); }
+  void push_back(T const &t) { v.push_back(t); }
+  T *data() { return v.data(); }
+  T const *data() const { return v.data(); }
+  size_t size() const { return v.size(); }
+  T const *begin() const { return v.data(); }
+  T const *end() const { return v.data() + v.size(); }
+};
+
+// bulk_append (append.h) against the element-by-element variants above.
+// Each iteration appends the source to an empty container; reports
+// ns/element. The result of one untimed run is compared with the source.
+template <typename C, typename T, typename Fn>
+void measure_append(std::string const &name, std::vector<T> const &src,
+                    Fn fn) {
+  size_t n = src.size();
+  C check;
+  fn(check);
+  if (check.size() != n ||
+      !std::equal(check.begin(), check.end(), src.begin()))
+    std::cout << name << ": wrong contents" << std::endl;
+  auto r = bench::run(name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      C c;
+      fn(c);
+      doNotOptimizeAway(c.size());
+    }
+  });
+  bench::scale(r, n);
+  bench::printRow(r);
+}
+
+template <typename C, typename T>
+void bench_append_case(std::string const &name, std::vector<T> const &src) {
+  T const *p = src.data();
+  size_t n = src.size();
+  // the !has_reserve overload of append drops the elements, skip it
+  if constexpr (has_reserve<C>::value)
+    measure_append<C>(name + " append", src, [&](C &c) { append(c, p, n); });
+  measure_append<C>(name + " tag_dispatch_append", src,
+                    [&](C &c) { tag_dispatch_append(c, p, n); });
+  measure_append<C>(name + " bulk_append", src,
+                    [&](C &c) { bulk_append(c, p, n); });
+}
+
+void bench_append() {
+  for (size_t n : {16, 4096}) {
+    std::vector<int> ints(n);
+    std::vector<char> bytes(n);
+    std::vector<std::string> strings(n);
+    for (size_t i = 0; i < n; ++i) {
+      ints[i] = static_cast<int>(i * 7);
+      bytes[i] = static_cast<char>('a' + i % 26);
+      strings[i] = std::string(40, 's') + std::to_string(i);
+    }
+    bench::printHeader("bench_append, " + std::to_string(n) +
+                       " elements, ns/element");
+    bench_append_case<std::vector<int>>("vector<int>", ints);
+    bench_append_case<std::string>("string", bytes);
+    bench_append_case<std::deque<int>>("deque<int>", ints);
+    bench_append_case<flat_buffer<int>>("flat_buffer<int>", ints);
+    bench_append_case<std::vector<std::string>>("vector<string>", strings);
+    // rvalue source: bulk_append moves the strings instead of copying them;
+    // both rows include copying strings into the temporary
+    using VS = std::vector<std::string>;
+    measure_append<VS>("vector<string> from temporary, copy", strings,
+                       [&](VS &c) {
+                         VS tmp(strings);
+                         bulk_append(c, tmp);
+                       });
+    measure_append<VS>("vector<string> from temporary, move", strings,
+                       [&](VS &c) {
+                         VS tmp(strings);
+                         bulk_append(c, std::move(tmp));
+                       });
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bench::parseArgs(argc, argv);
   test_has_reserve();
   test_append();
   test_decl_append();
   test_tag_dispatch_append();
   test_constexpr_append();
+  test_bulk_append_self();
+  bench_append();
   return 0;
 }
@@ -0,0 +1,224 @@
+// Array-of-structs vs soa_vector on scan- and filter-heavy workloads over a
+// per-request metadata table. Each workload runs over the same rows in both
+// layouts; the report gives ns per row and the SoA speedup.
+//
+// Run: build/soa_bench [--reps=N] [--target_ms=X] [--json=PATH]
+
+#include "../performance/bench.h"
+#include "soa_vector.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// 72 bytes per row: a scan over one field uses 4-8 bytes of every 64-byte line.
+struct Request {
+  uint64_t id;
+  int64_t start_us;
+  uint32_t latency_us;
+  uint16_t status;
+  uint8_t method;
+  std::array<char, 45> path;
+};
+
+using AoS = std::vector<Request>;
+using SoA = soa_vector<uint64_t, int64_t, uint32_t, uint16_t, uint8_t,
+                       std::array<char, 45>>;
+
+enum { ID, START, LATENCY, STATUS, METHOD, PATH };
+
+// Workloads. Each exists once per layout with the same loop shape.
+
+NOINLINE uint64_t sum_latency(AoS const &t) {
+  uint64_t sum = 0;
+  for (Request const &r : t)
+    sum += r.latency_us;
+  return sum;
+}
+
+NOINLINE uint64_t sum_latency(SoA const &t) {
+  uint64_t sum = 0;
+  for (uint32_t l : t.column<LATENCY>())
+    sum += l;
+  return sum;
+}
+
+NOINLINE std::size_t count_slow_errors(AoS const &t, uint32_t slow) {
+  std::size_t n = 0;
+  for (Request const &r : t)
+    n += (r.status >= 500) & (r.latency_us > slow);
+  return n;
+}
+
+NOINLINE std::size_t count_slow_errors(SoA const &t, uint32_t slow) {
+  auto status = t.column<STATUS>();
+  auto latency = t.column<LATENCY>();
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < t.size(); ++i)
+    n += (status[i] >= 500) & (latency[i] > slow);
+  return n;
+}
+
+NOINLINE uint64_t window_latency(AoS const &t, int64_t lo, int64_t hi) {
+  uint64_t sum = 0;
+  for (Request const &r : t)
+    sum += (r.start_us >= lo && r.start_us < hi) ? r.latency_us : 0;
+  return sum;
+}
+
+NOINLINE uint64_t window_latency(SoA const &t, int64_t lo, int64_t hi) {
+  auto start = t.column<START>();
+  auto latency = t.column<LATENCY>();
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < t.size(); ++i)
+    sum += (start[i] >= lo && start[i] < hi) ? latency[i] : 0;
+  return sum;
+}
+
+NOINLINE void select_ids(AoS const &t, uint32_t slow,
+                         std::vector<uint64_t> &out) {
+  out.clear();
+  for (Request const &r : t)
+    if (r.latency_us > slow)
+      out.push_back(r.id);
+}
+
+NOINLINE void select_ids(SoA const &t, uint32_t slow,
+                         std::vector<uint64_t> &out) {
+  auto latency = t.column<LATENCY>();
+  auto id = t.column<ID>();
+  out.clear();
+  for (std::size_t i = 0; i < t.size(); ++i)
+    if (latency[i] > slow)
+      out.push_back(id[i]);
+}
+
+// Touches every field: the case where AoS should hold its own.
+NOINLINE uint64_t full_row(AoS const &t) {
+  uint64_t h = 0;
+  for (Request const &r : t)
+    h += r.id ^ r.start_us ^ r.latency_us ^ r.status ^ r.method ^ r.path[0];
+  return h;
+}
+
+NOINLINE uint64_t full_row(SoA const &t) {
+  uint64_t h = 0;
+  for (auto [id, start, latency, status, method, path] : t)
+    h += id ^ start ^ latency ^ status ^ method ^ path[0];
+  return h;
+}
+
+// soa_vector rows go through std::sort like structs do.
+bool sorted_alike(AoS aos, SoA soa) {
+  std::sort(aos.begin(), aos.end(), [](Request const &a, Request const &b) {
+    return std::tie(a.latency_us, a.id) < std::tie(b.latency_us, b.id);
+  });
+  std::sort(soa.begin(), soa.end(), [](auto const &a, auto const &b) {
+    return std::tie(std::get<LATENCY>(a), std::get<ID>(a)) <
+           std::tie(std::get<LATENCY>(b), std::get<ID>(b));
+  });
+  for (std::size_t i = 0; i < aos.size(); ++i)
+    if (aos[i].id != std::get<ID>(soa[i]) ||
+        aos[i].start_us != std::get<START>(soa[i]))
+      return false;
+  return true;
+}
+
+template <class Fn>
+double per_row(std::string const &name, std::size_t rows, Fn fn) {
+  auto r = bench::run(name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      fn();
+  });
+  bench::scale(r, rows);
+  bench::printRow(r);
+  return r.median;
+}
+
+struct Speedup {
+  const char *workload;
+  double aos, soa;
+};
+
+// Rows go to the bench table; the speedup summary is printed after it.
+template <class Aos, class Soa>
+void compare(std::vector<Speedup> &summary, const char *workload,
+             std::size_t rows, Aos aos, Soa soa) {
+  double a = per_row(std::string(workload) + ": AoS", rows, aos);
+  double s = per_row(std::string(workload) + ": SoA", rows, soa);
+  summary.push_back({workload, a, s});
+}
+
+void run_table(std::size_t rows) {
+  std::mt19937_64 rng(rows);
+  AoS aos(rows);
+  SoA soa;
+  soa.reserve(rows);
+  for (std::size_t i = 0; i < rows; ++i) {
+    Request &r = aos[i];
+    r.id = rng();
+    r.start_us = static_cast<int64_t>(i) * 10 + rng() % 10;
+    // Mostly fast, ~1% above 10ms.
+    r.latency_us = rng() % 100 ? 100 + rng() % 2000 : 10000 + rng() % 90000;
+    r.status = rng() % 50 ? 200 : 500 + rng() % 4;
+    r.method = rng() % 4;
+    r.path.fill('/');
+    soa.push_back(r.id, r.start_us, r.latency_us, r.status, r.method, r.path);
+  }
+  if (sum_latency(aos) != sum_latency(soa) ||
+      full_row(aos) != full_row(soa) || !sorted_alike(aos, soa)) {
+    std::fprintf(stderr, "layouts disagree\n");
+    std::exit(1);
+  }
+
+  int64_t lo = static_cast<int64_t>(rows) * 4, hi = lo + rows * 2;
+  std::vector<uint64_t> ids;
+  ids.reserve(rows);
+
+  bench::printHeader(std::to_string(rows) + " rows (" +
+                     std::to_string(rows * sizeof(Request) >> 10) +
+                     " KB as AoS), ns/row");
+  std::vector<Speedup> summary;
+  compare(
+      summary, "sum latency", rows,
+      [&] { doNotOptimizeAway(sum_latency(aos)); },
+      [&] { doNotOptimizeAway(sum_latency(soa)); });
+  compare(
+      summary, "count slow 5xx", rows,
+      [&] { doNotOptimizeAway(count_slow_errors(aos, 1000)); },
+      [&] { doNotOptimizeAway(count_slow_errors(soa, 1000)); });
+  compare(
+      summary, "time window", rows,
+      [&] { doNotOptimizeAway(window_latency(aos, lo, hi)); },
+      [&] { doNotOptimizeAway(window_latency(soa, lo, hi)); });
+  compare(
+      summary, "select slow ids", rows,
+      [&] {
+        select_ids(aos, 10000, ids);
+        doNotOptimizeAway(ids.size());
+      },
+      [&] {
+        select_ids(soa, 10000, ids);
+        doNotOptimizeAway(ids.size());
+      });
+  compare(
+      summary, "full row", rows, [&] { doNotOptimizeAway(full_row(aos)); },
+      [&] { doNotOptimizeAway(full_row(soa)); });
+
+  std::printf("\n%-20s %10s %10s %10s\n", "workload", "AoS", "SoA", "speedup");
+  for (Speedup const &x : summary)
+    std::printf("%-20s %10.3f %10.3f %9.2fx\n", x.workload, x.aos, x.soa,
+                x.aos / x.soa);
+}
+
+int main(int argc, char *argv[]) {
+  bench::parseArgs(argc, argv);
+  run_table(1 << 12);
+  run_table(1 << 21);
+  return 0;
+}
@@ -0,0 +1,343 @@
+#pragma once
+// soa_vector<Ts...>: struct-of-arrays container. Each field lives in its own
+// contiguous, 64-byte aligned array, so a scan over one field touches only
+// that field's cache lines and vectorizes like a plain array loop.
+//
+//     soa_vector<uint64_t, int32_t, uint16_t> reqs;  // id, latency, status
+//     reqs.push_back(1, 250, 200);
+//     auto [id, latency, status] = reqs[0];          // references into the columns
+//     for (int32_t l: reqs.column<1>()) sum += l;    // contiguous column
+//
+// Rows are tuples of references (and print like tuples with print.h); the
+// iterator's value_type is the owning std::tuple<Ts...>. Assigning to a row
+// writes through to the columns and rows swap element-wise, so std::sort,
+// std::reverse and other permuting algorithms work on begin()/end().
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace _soa_details {
+    template <class T, std::size_t Align = 64>
+    struct aligned_allocator {
+        using value_type = T;
+
+        template <class U>
+        struct rebind {
+            using other = aligned_allocator<U, Align>;
+        };
+
+        aligned_allocator() = default;
+
+        template <class U>
+        aligned_allocator(aligned_allocator<U, Align> const &) {
+        }
+
+        T *allocate(std::size_t n) {
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+        }
+
+        void deallocate(T *p, std::size_t) {
+            ::operator delete(p, std::align_val_t(Align));
+        }
+
+        template <class U>
+        bool operator==(aligned_allocator<U, Align> const &) const {
+            return true;
+        }
+
+        template <class U>
+        bool operator!=(aligned_allocator<U, Align> const &) const {
+            return false;
+        }
+    };
+
+    // Contiguous view of one column (a minimal std::span).
+    template <class T>
+    class column_view {
+        T *ptr = nullptr;
+        std::size_t len = 0;
+
+    public:
+        column_view() = default;
+
+        column_view(T *ptr_, std::size_t len_) : ptr(ptr_), len(len_) {
+        }
+
+        T *data() const {
+            return ptr;
+        }
+
+        std::size_t size() const {
+            return len;
+        }
+
+        T *begin() const {
+            return ptr;
+        }
+
+        T *end() const {
+            return ptr + len;
+        }
+
+        T &operator[](std::size_t i) const {
+            return ptr[i];
+        }
+    };
+
+    // A row: std::tuple of references into the columns. The base class gives
+    // get<I>, comparisons and assignment through the references; swap is
+    // found by ADL from std algorithms, which swap prvalue rows.
+    template <class ...Rs>
+    class row_ref : public std::tuple<Rs...> {
+        template <std::size_t ...Is>
+        void _swap(row_ref &o, std::index_sequence<Is...>) {
+            using std::swap;
+            (swap(std::get<Is>(*this), std::get<Is>(o)), ...);
+        }
+
+    public:
+        using std::tuple<Rs...>::tuple;
+        using std::tuple<Rs...>::operator=;
+
+        friend void swap(row_ref a, row_ref b) {
+            a._swap(b, std::index_sequence_for<Rs...>{});
+        }
+    };
+
+    template <class ...Ts>
+    class soa_vector {
+        static_assert(sizeof...(Ts) > 0, "soa_vector needs at least one column");
+        static_assert((!std::is_same_v<Ts, bool> && ...), "soa_vector<bool> columns would be bit-packed std::vector<bool>; use char or uint8_t");
+
+        std::tuple<std::vector<Ts, aligned_allocator<Ts>>...> columns;
+
+        template <std::size_t ...Is>
+        row_ref<Ts &...> _row(std::size_t i, std::index_sequence<Is...>) {
+            return row_ref<Ts &...>(std::get<Is>(columns)[i]...);
+        }
+
+        template <std::size_t ...Is>
+        row_ref<Ts const &...> _row(std::size_t i, std::index_sequence<Is...>) const {
+            return row_ref<Ts const &...>(std::get<Is>(columns)[i]...);
+        }
+
+        template <class Fn, std::size_t ...Is>
+        void _each_column(Fn &&fn, std::index_sequence<Is...>) {
+            (fn(std::get<Is>(columns)), ...);
+        }
+
+        template <class Self, class Row>
+        class _iterator {
+            Self *self;
+            std::size_t i;
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::tuple<Ts...>;
+            using difference_type = std::ptrdiff_t;
+            using reference = Row;
+            using pointer = void;
+
+            _iterator(Self *self_, std::size_t i_) : self(self_), i(i_) {
+            }
+
+            Row operator*() const {
+                return (*self)[i];
+            }
+
+            Row operator[](difference_type n) const {
+                return (*self)[i + n];
+            }
+
+            _iterator &operator++() {
+                ++i;
+                return *this;
+            }
+
+            _iterator operator++(int) {
+                return _iterator(self, i++);
+            }
+
+            _iterator &operator--() {
+                --i;
+                return *this;
+            }
+
+            _iterator operator--(int) {
+                return _iterator(self, i--);
+            }
+
+            _iterator &operator+=(difference_type n) {
+                i += n;
+                return *this;
+            }
+
+            _iterator &operator-=(difference_type n) {
+                i -= n;
+                return *this;
+            }
+
+            _iterator operator+(difference_type n) const {
+                return _iterator(self, i + n);
+            }
+
+            friend _iterator operator+(difference_type n, _iterator const &it) {
+                return it + n;
+            }
+
+            _iterator operator-(difference_type n) const {
+                return _iterator(self, i - n);
+            }
+
+            difference_type operator-(_iterator const &o) const {
+                return static_cast<difference_type>(i) - static_cast<difference_type>(o.i);
+            }
+
+            bool operator==(_iterator const &o) const {
+                return i == o.i;
+            }
+
+            bool operator!=(_iterator const &o) const {
+                return i != o.i;
+            }
+
+            bool operator<(_iterator const &o) const {
+                return i < o.i;
+            }
+
+            bool operator>(_iterator const &o) const {
+                return i > o.i;
+            }
+
+            bool operator<=(_iterator const &o) const {
+                return i <= o.i;
+            }
+
+            bool operator>=(_iterator const &o) const {
+                return i >= o.i;
+            }
+        };
+
+    public:
+        using value_type = std::tuple<Ts...>;
+        using row = row_ref<Ts &...>;
+        using const_row = row_ref<Ts const &...>;
+        using iterator = _iterator<soa_vector, row>;
+        using const_iterator = _iterator<soa_vector const, const_row>;
+
+        static constexpr std::size_t num_columns = sizeof...(Ts);
+
+        std::size_t size() const {
+            return std::get<0>(columns).size();
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        void reserve(std::size_t n) {
+            _each_column([&] (auto &c) { c.reserve(n); }, std::index_sequence_for<Ts...>{});
+        }
+
+        void resize(std::size_t n) {
+            std::size_t old = size();
+            try {
+                _each_column([&] (auto &c) { c.resize(n); }, std::index_sequence_for<Ts...>{});
+            } catch (...) {
+                _each_column([&] (auto &c) { if (c.size() > old) c.resize(old); }, std::index_sequence_for<Ts...>{});
+                throw;
+            }
+        }
+
+        void clear() {
+            _each_column([&] (auto &c) { c.clear(); }, std::index_sequence_for<Ts...>{});
+        }
+
+        void pop_back() {
+            _each_column([&] (auto &c) { c.pop_back(); }, std::index_sequence_for<Ts...>{});
+        }
+
+        template <class ...Us>
+        void push_back(Us &&...us) {
+            static_assert(sizeof...(Us) == sizeof...(Ts), "push_back needs one value per column");
+            _push_back(std::index_sequence_for<Ts...>{}, std::forward<Us>(us)...);
+        }
+
+        // O(1) erase that does not keep order: the last row moves into slot i.
+        void swap_remove(std::size_t i) {
+            std::size_t last = size() - 1;
+            if (i != last) {
+                _each_column([&] (auto &c) { c[i] = std::move(c[last]); }, std::index_sequence_for<Ts...>{});
+            }
+            pop_back();
+        }
+
+        row operator[](std::size_t i) {
+            return _row(i, std::index_sequence_for<Ts...>{});
+        }
+
+        const_row operator[](std::size_t i) const {
+            return _row(i, std::index_sequence_for<Ts...>{});
+        }
+
+        template <std::size_t I>
+        auto column() {
+            auto &c = std::get<I>(columns);
+            return column_view<typename std::decay_t<decltype(c)>::value_type>(c.data(), c.size());
+        }
+
+        template <std::size_t I>
+        auto column() const {
+            auto &c = std::get<I>(columns);
+            return column_view<typename std::decay_t<decltype(c)>::value_type const>(c.data(), c.size());
+        }
+
+        iterator begin() {
+            return iterator(this, 0);
+        }
+
+        iterator end() {
+            return iterator(this, size());
+        }
+
+        const_iterator begin() const {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const {
+            return const_iterator(this, size());
+        }
+
+    private:
+        // Columns are appended one at a time; if one throws, the columns
+        // already appended drop their new element so all sizes still match.
+        template <std::size_t ...Is, class ...Us>
+        void _push_back(std::index_sequence<Is...>, Us &&...us) {
+            std::size_t old = size();
+            try {
+                (std::get<Is>(columns).push_back(std::forward<Us>(us)), ...);
+            } catch (...) {
+                _each_column([&] (auto &c) { if (c.size() > old) c.pop_back(); }, std::index_sequence_for<Ts...>{});
+                throw;
+            }
+        }
+    };
+}
+
+namespace std {
+    template <class ...Rs>
+    struct tuple_size<_soa_details::row_ref<Rs...>> : tuple_size<tuple<Rs...>> {
+    };
+
+    template <size_t I, class ...Rs>
+    struct tuple_element<I, _soa_details::row_ref<Rs...>> : tuple_element<I, tuple<Rs...>> {
+    };
+}
+
+using _soa_details::soa_vector;
+using _soa_details::column_view;
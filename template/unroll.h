@@ -0,0 +1,43 @@
+#pragma once
+// Compile-time loop unrolling.
+//
+// static_for<N>(f) calls f(std::integral_constant<std::size_t, I>{}) for
+// I = 0..N-1, so the index is usable as a template argument or array index
+// that the compiler sees as a constant:
+//
+//     double acc[4] = {};
+//     static_for<4>([&] (auto j) { acc[j] += p[i + j]; });
+//
+// The driver is always inlined; mark the lambda with UNROLL_INLINE as well
+// when its body is large enough that the compiler might keep it out of line:
+//
+//     static_for<8>([&] (auto j) UNROLL_INLINE { ... });
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define UNROLL_INLINE __attribute__((always_inline))
+#define _UNROLL_FORCE_INLINE __attribute__((always_inline)) inline
+#elif defined(_MSC_VER)
+#define UNROLL_INLINE
+#define _UNROLL_FORCE_INLINE __forceinline
+#else
+#define UNROLL_INLINE
+#define _UNROLL_FORCE_INLINE inline
+#endif
+
+namespace _unroll_details {
+    template <class F, std::size_t ...Is>
+    _UNROLL_FORCE_INLINE void _static_for(F &f, std::index_sequence<Is...>) {
+        (f(std::integral_constant<std::size_t, Is>{}), ...);
+    }
+
+    template <std::size_t N, class F>
+    _UNROLL_FORCE_INLINE void static_for(F &&f) {
+        _static_for(f, std::make_index_sequence<N>{});
+    }
+}
+
+using _unroll_details::static_for;